@@ -47,9 +47,10 @@
 /*
  * User exception setup.
  * See cexcept.h for more info
+ * The context is thread local, each thread has its own Try/Throw chain.
  */
 define_exception_type(const char *);
-struct exception_context the_exception_context[1];
+OPNG_THREAD_LOCAL struct exception_context the_exception_context[1];
 
 
 /*
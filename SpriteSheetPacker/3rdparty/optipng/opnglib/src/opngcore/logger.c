@@ -17,11 +17,14 @@
 
 #include "sysexits.h"
 
+#define OPNGLIB_INTERNAL
+#include "util.h"
+
 
 static const char *logging_program_name = NULL;
 static unsigned int logging_level = OPNG_MSG_DEFAULT;
 static int logging_format = OPNG_MSGFMT_DEFAULT;
-static int logging_start_of_line = 1;
+static OPNG_THREAD_LOCAL int logging_start_of_line = 1;
 
 
 /*
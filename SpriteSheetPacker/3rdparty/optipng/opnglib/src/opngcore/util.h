@@ -58,6 +58,21 @@ extern "C" {
 #endif
 
 
+/*** Thread utilities ***/
+
+/*
+ * Storage class for global state that must be private to each thread,
+ * so that independent optimizers can run concurrently.
+ */
+#if defined(_MSC_VER)
+#define OPNG_THREAD_LOCAL __declspec(thread)
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+#define OPNG_THREAD_LOCAL _Thread_local
+#else
+#define OPNG_THREAD_LOCAL __thread
+#endif
+
+
 /*** Character type utilities ***/
 
 /*
@@ -0,0 +1,106 @@
+#include "ImageBlit.h"
+#include "ImageRotate.h"
+#include <QtConcurrent>
+#include <QDebug>
+#include <string.h>
+
+namespace {
+
+    const int TILE = 32;
+
+    // dst pixel (x, y) of a rotated sprite comes from src pixel (y, height - 1 - x)
+    void copyRotated(uchar* dst, int dstStride, const uchar* src, int srcStride, int width, int height,
+                     const uchar* mask, int maskStride) {
+        for (int y0 = 0; y0 < height; y0 += TILE) {
+            int y1 = qMin(y0 + TILE, height);
+            for (int x0 = 0; x0 < width; x0 += TILE) {
+                int x1 = qMin(x0 + TILE, width);
+                // source tile rows become destination columns
+                for (int sy = y0; sy < y1; ++sy) {
+                    const quint32* srcLine = reinterpret_cast<const quint32*>(src + sy * srcStride);
+                    const uchar* maskLine = mask? mask + sy * maskStride : nullptr;
+                    int dx = height - 1 - sy;
+                    for (int sx = x0; sx < x1; ++sx) {
+                        if (maskLine && !maskLine[sx]) continue;
+                        reinterpret_cast<quint32*>(dst + sx * dstStride)[dx] = srcLine[sx];
+                    }
+                }
+            }
+        }
+    }
+
+    void copyRows(uchar* dst, int dstStride, const uchar* src, int srcStride, int width, int height,
+                  const uchar* mask, int maskStride) {
+        for (int y = 0; y < height; ++y) {
+            const uchar* srcLine = src + y * srcStride;
+            uchar* dstLine = dst + y * dstStride;
+            if (!mask) {
+                memcpy(dstLine, srcLine, width * 4);
+                continue;
+            }
+            const uchar* maskLine = mask + y * maskStride;
+            for (int x = 0; x < width; ++x) {
+                if (maskLine[x]) {
+                    reinterpret_cast<quint32*>(dstLine)[x] = reinterpret_cast<const quint32*>(srcLine)[x];
+                }
+            }
+        }
+    }
+
+    void blit(uchar* dstBits, int dstStride, const QSize& dstSize, const BlitJob& job) {
+        if (!job.image->rect().contains(job.rect)) {
+            qWarning() << "blitImage: rect outside of the image" << job.rect;
+            return;
+        }
+
+        // part of the sprite inside dst, as sub rect of job.rect (local coordinates) and where it goes
+        QSize size = job.rotated? job.rect.size().transposed() : job.rect.size();
+        QRect visible = QRect(job.pos, size) & QRect(QPoint(0, 0), dstSize);
+        if (visible.isEmpty()) return;
+        QPoint from = visible.topLeft() - job.pos;
+        QRect sub = job.rotated? QRect(from.y(), job.rect.height() - from.x() - visible.width(), visible.height(), visible.width())
+                               : QRect(from, visible.size());
+
+        QImage converted;
+        const uchar* src;
+        int srcStride;
+        if (job.image->format() == QImage::Format_RGBA8888) {
+            srcStride = job.image->bytesPerLine();
+            src = job.image->constBits() + (job.rect.y() + sub.y()) * srcStride + (job.rect.x() + sub.x()) * 4;
+        } else {
+            converted = job.image->copy(sub.translated(job.rect.topLeft())).convertToFormat(QImage::Format_RGBA8888);
+            srcStride = converted.bytesPerLine();
+            src = converted.constBits();
+        }
+
+        const bool useMask = (job.mask.format() == QImage::Format_Alpha8) && (job.mask.size() == job.rect.size());
+        const int maskStride = job.mask.bytesPerLine();
+        const uchar* mask = useMask? job.mask.constBits() + sub.y() * maskStride + sub.x() : nullptr;
+
+        uchar* dst = dstBits + visible.y() * dstStride + visible.x() * 4;
+        if (job.rotated && !mask) {
+            rotate90Pixels(dst, dstStride, src, srcStride, sub.width(), sub.height());
+        } else if (job.rotated) {
+            copyRotated(dst, dstStride, src, srcStride, sub.width(), sub.height(), mask, maskStride);
+        } else {
+            copyRows(dst, dstStride, src, srcStride, sub.width(), sub.height(), mask, maskStride);
+        }
+    }
+
+}
+
+void blitImage(QImage& dst, const BlitJob& job) {
+    Q_ASSERT(dst.format() == QImage::Format_RGBA8888);
+    blit(dst.bits(), dst.bytesPerLine(), dst.size(), job);
+}
+
+void blitImages(QImage& dst, QVector<BlitJob> jobs) {
+    Q_ASSERT(dst.format() == QImage::Format_RGBA8888);
+    // detach once here, the workers only get the raw buffer
+    uchar* bits = dst.bits();
+    const int stride = dst.bytesPerLine();
+    const QSize size = dst.size();
+    QtConcurrent::blockingMap(jobs, [bits, stride, size](BlitJob& job) {
+        blit(bits, stride, size, job);
+    });
+}
@@ -0,0 +1,25 @@
+#ifndef IMAGEBLIT_H
+#define IMAGEBLIT_H
+
+#include <QImage>
+#include <QVector>
+
+// One sprite to copy into the atlas: rect of image goes to pos, turned 90 degrees
+// clockwise when rotated (same as rotate90()). mask is optional, rect sized Format_Alpha8
+// in the unrotated orientation; only pixels with non zero mask are written.
+struct BlitJob {
+    const QImage*   image;
+    QRect           rect;
+    QPoint          pos;
+    bool            rotated;
+    QImage          mask;
+};
+
+// Copies the job pixels into dst (Format_RGBA8888) replacing what is there, rows with memcpy
+// and rotated sprites with the blocked transpose of ImageRotate. Pixels outside dst are clipped.
+void blitImage(QImage& dst, const BlitJob& job);
+
+// Runs all jobs concurrently, jobs must not write the same pixels.
+void blitImages(QImage& dst, QVector<BlitJob> jobs);
+
+#endif // IMAGEBLIT_H
@@ -0,0 +1,192 @@
+/* ImageRotate
+Functions for image rotating for values of 90-degrees multiples
+Copyright (C) 2005-2006 Wesley Crossman
+Email: wesley@crossmans.net
+
+You can redistribute and/or modify this software under the terms of the GNU
+General Public License as published by the Free Software Foundation;
+either version 2 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this
+program; if not, write to the Free Software Foundation, Inc., 59 Temple Place,
+Suite 330, Boston, MA 02111-1307 USA */
+
+#include "ImageRotate.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define IMAGE_ROTATE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+    // the transpose works on TILE x TILE blocks so source rows and destination rows stay in cache
+    const int TILE = 16;
+
+    inline quint32* pixelAt(uchar *bits, int stride, int x, int y) {
+        return reinterpret_cast<quint32*>(bits + y * stride) + x;
+    }
+
+    inline const quint32* pixelAt(const uchar *bits, int stride, int x, int y) {
+        return reinterpret_cast<const quint32*>(bits + y * stride) + x;
+    }
+
+    // source (x, y) goes to (height - 1 - y, x) when clockwise, to (y, width - 1 - x) otherwise
+    template<bool clockwise>
+    void transposeScalar(uchar *dst, int dstStride, const uchar *src, int srcStride, int width, int height,
+                         int x0, int y0, int x1, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            const quint32 *srcLine = pixelAt(src, srcStride, 0, y);
+            for (int x = x0; x < x1; ++x) {
+                if (clockwise) {
+                    *pixelAt(dst, dstStride, height - 1 - y, x) = srcLine[x];
+                } else {
+                    *pixelAt(dst, dstStride, y, width - 1 - x) = srcLine[x];
+                }
+            }
+        }
+    }
+
+#ifdef IMAGE_ROTATE_SSE2
+    // 4x4 block at (x, y), the rows are loaded bottom up when clockwise so the transposed
+    // columns already come out in destination order
+    template<bool clockwise>
+    inline void transpose4x4(uchar *dst, int dstStride, const uchar *src, int srcStride, int width, int height,
+                             int x, int y) {
+        __m128i r0, r1, r2, r3;
+        if (clockwise) {
+            r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixelAt(src, srcStride, x, y + 3)));
+            r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixelAt(src, srcStride, x, y + 2)));
+            r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixelAt(src, srcStride, x, y + 1)));
+            r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixelAt(src, srcStride, x, y)));
+        } else {
+            r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixelAt(src, srcStride, x, y)));
+            r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixelAt(src, srcStride, x, y + 1)));
+            r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixelAt(src, srcStride, x, y + 2)));
+            r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixelAt(src, srcStride, x, y + 3)));
+        }
+
+        __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+        __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+        __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+        __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+        __m128i columns[4] = {
+            _mm_unpacklo_epi64(t0, t1),
+            _mm_unpackhi_epi64(t0, t1),
+            _mm_unpacklo_epi64(t2, t3),
+            _mm_unpackhi_epi64(t2, t3)
+        };
+
+        for (int k = 0; k < 4; ++k) {
+            quint32 *dstLine = clockwise? pixelAt(dst, dstStride, height - 4 - y, x + k)
+                                        : pixelAt(dst, dstStride, y, width - 1 - x - k);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dstLine), columns[k]);
+        }
+    }
+#endif
+
+    template<bool clockwise>
+    void transpose(uchar *dst, int dstStride, const uchar *src, int srcStride, int width, int height) {
+        for (int y0 = 0; y0 < height; y0 += TILE) {
+            int y1 = qMin(y0 + TILE, height);
+            for (int x0 = 0; x0 < width; x0 += TILE) {
+                int x1 = qMin(x0 + TILE, width);
+#ifdef IMAGE_ROTATE_SSE2
+                int xEnd = x0 + ((x1 - x0) & ~3);
+                int yEnd = y0 + ((y1 - y0) & ~3);
+                for (int y = y0; y < yEnd; y += 4) {
+                    for (int x = x0; x < xEnd; x += 4) {
+                        transpose4x4<clockwise>(dst, dstStride, src, srcStride, width, height, x, y);
+                    }
+                }
+                // edges of the tile that are not a whole 4x4 block
+                transposeScalar<clockwise>(dst, dstStride, src, srcStride, width, height, xEnd, y0, x1, y1);
+                transposeScalar<clockwise>(dst, dstStride, src, srcStride, width, height, x0, yEnd, xEnd, y1);
+#else
+                transposeScalar<clockwise>(dst, dstStride, src, srcStride, width, height, x0, y0, x1, y1);
+#endif
+            }
+        }
+    }
+
+    // the kernels only handle 32-bit pixels, other depths are converted first
+    QImage image32(const QImage &src) {
+        return (src.depth() == 32)? src : src.convertToFormat(QImage::Format_ARGB32);
+    }
+
+}
+
+void rotate90Pixels(uchar *dst, int dstStride, const uchar *src, int srcStride, int width, int height) {
+    transpose<true>(dst, dstStride, src, srcStride, width, height);
+}
+
+void rotate270Pixels(uchar *dst, int dstStride, const uchar *src, int srcStride, int width, int height) {
+    transpose<false>(dst, dstStride, src, srcStride, width, height);
+}
+
+void rotate180Pixels(uchar *dst, int dstStride, const uchar *src, int srcStride, int width, int height) {
+    for (int y = 0; y < height; ++y) {
+        const quint32 *srcLine = pixelAt(src, srcStride, 0, y);
+        quint32 *dstLine = pixelAt(dst, dstStride, 0, height - 1 - y);
+        int x = 0;
+#ifdef IMAGE_ROTATE_SSE2
+        for (; x + 4 <= width; x += 4) {
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcLine + x));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dstLine + width - 4 - x), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(0, 1, 2, 3)));
+        }
+#endif
+        for (; x < width; ++x) {
+            dstLine[width - 1 - x] = srcLine[x];
+        }
+    }
+}
+
+QImage rotate(int degrees, const QImage &src) {
+    if (degrees == 90) {
+        return rotate90(src);
+    } else if (degrees == 180) {
+        return rotate180(src);
+    } else if (degrees == 270 || degrees == -90) {
+        return rotate270(src);
+    } else if (degrees == 0 || degrees == 360) {
+        return src;
+    } else {
+        return QImage();
+    }
+}
+QImage rotate90(const QImage &src) {
+    QImage image = image32(src);
+    QImage dst(image.height(), image.width(), image.format());
+    rotate90Pixels(dst.bits(), dst.bytesPerLine(), image.constBits(), image.bytesPerLine(), image.width(), image.height());
+    return dst;
+}
+QImage rotate180(const QImage &src) {
+    QImage image = image32(src);
+    QImage dst(image.width(), image.height(), image.format());
+    rotate180Pixels(dst.bits(), dst.bytesPerLine(), image.constBits(), image.bytesPerLine(), image.width(), image.height());
+    return dst;
+}
+QImage rotate270(const QImage &src) {
+    QImage image = image32(src);
+    QImage dst(image.height(), image.width(), image.format());
+    rotate270Pixels(dst.bits(), dst.bytesPerLine(), image.constBits(), image.bytesPerLine(), image.width(), image.height());
+    return dst;
+}
+
+//convenience functions which convert from/to qpixmap
+QPixmap rotate(int degrees, const QPixmap &src) {
+    return QPixmap::fromImage(rotate(degrees, src.toImage()));
+}
+QPixmap rotate90(const QPixmap &src) {
+    return QPixmap::fromImage(rotate90(src.toImage()));
+}
+QPixmap rotate180(const QPixmap &src) {
+    return QPixmap::fromImage(rotate180(src.toImage()));
+}
+QPixmap rotate270(const QPixmap &src) {
+    return QPixmap::fromImage(rotate270(src.toImage()));
+}
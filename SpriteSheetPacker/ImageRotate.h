@@ -26,66 +26,16 @@ QImage rotate90(const QImage &src);
 QImage rotate180(const QImage &src);
 QImage rotate270(const QImage &src);
 
-QImage rotate(int degrees, const QImage &src) {
-    if (degrees == 90) {
-        return rotate90(src);
-    } else if (degrees == 180) {
-        return rotate180(src);
-    } else if (degrees == 270 || degrees == -90) {
-        return rotate270(src);
-    } else if (degrees == 0 || degrees == 360) {
-        return src;
-    } else {
-        return QImage();
-    }
-}
-QImage rotate90(const QImage &src) {
-    QImage dst(src.height(), src.width(), src.format());
-    for (int y=0;y<src.height();++y) {
-        const uint *srcLine = reinterpret_cast< const uint * >(src.scanLine(y));
-        for (int x=0;x<src.width();++x) {
-            dst.setPixel(src.height()-y-1, x, srcLine[x]);
-        }
-    }
-    return dst;
-}
-QImage rotate180(const QImage &src) {
-    QImage dst(src.width(), src.height(), src.format());
-    for (int y=0;y<src.height();++y) {
-        const uint *srcLine = reinterpret_cast< const uint * >(src.scanLine(y));
-        for (int x=0;x<src.width();++x) {
-            dst.setPixel(src.width()-x-1, src.height()-y-1, srcLine[x]);
-        }
-    }
-    return dst;
-}
-QImage rotate270(const QImage &src) {
-    QImage dst(src.height(), src.width(), src.format());
-    for (int y=0;y<src.height();++y) {
-        const uint *srcLine = reinterpret_cast< const uint * >(src.scanLine(y));
-        for (int x=0;x<src.width();++x) {
-            dst.setPixel(y, src.width()-x-1, srcLine[x]);
-        }
-    }
-    return dst;
-}
+// 32-bit pixel kernels behind the QImage versions (rotate90 is clockwise), width and height
+// are the source size, strides are in bytes and dst must hold the rotated size.
+void rotate90Pixels(uchar *dst, int dstStride, const uchar *src, int srcStride, int width, int height);
+void rotate270Pixels(uchar *dst, int dstStride, const uchar *src, int srcStride, int width, int height);
+void rotate180Pixels(uchar *dst, int dstStride, const uchar *src, int srcStride, int width, int height);
 
 //convenience functions which convert from/to qpixmap
 QPixmap rotate(int degrees, const QPixmap &src);
 QPixmap rotate90(const QPixmap &src);
 QPixmap rotate180(const QPixmap &src);
 QPixmap rotate270(const QPixmap &src);
-QPixmap rotate(int degrees, const QPixmap &src) {
-    return QPixmap::fromImage(rotate(degrees, src.toImage()));
-}
-QPixmap rotate90(const QPixmap &src) {
-    return QPixmap::fromImage(rotate90(src.toImage()));
-}
-QPixmap rotate180(const QPixmap &src) {
-    return QPixmap::fromImage(rotate180(src.toImage()));
-}
-QPixmap rotate270(const QPixmap &src) {
-    return QPixmap::fromImage(rotate270(src.toImage()));
-}
 
 #endif
@@ -0,0 +1,143 @@
+#include "ImageTrim.h"
+#include <QtAlgorithms>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define IMAGETRIM_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define IMAGETRIM_AVX2
+#include <immintrin.h>
+#endif
+
+namespace {
+
+    inline bool isOpaque(const uchar* line, int x, int alphaOffset, int threshold) {
+        return line[x * 4 + alphaOffset] >= threshold;
+    }
+
+    // first x in [from, to) with alpha >= threshold, or -1
+    int firstOpaque(const uchar* line, int from, int to, int alphaOffset, int threshold) {
+        int x = from;
+        if (alphaOffset == 3) {
+#ifdef IMAGETRIM_AVX2
+            const __m256i thr256 = _mm256_set1_epi8((char)threshold);
+            for (; x + 8 <= to; x += 8) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line + x * 4));
+                unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(v, thr256), v)) & 0x88888888u;
+                if (mask) return x + (qCountTrailingZeroBits(mask) >> 2);
+            }
+#endif
+#ifdef IMAGETRIM_SSE2
+            const __m128i thr128 = _mm_set1_epi8((char)threshold);
+            for (; x + 4 <= to; x += 4) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + x * 4));
+                unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, thr128), v)) & 0x8888u;
+                if (mask) return x + (qCountTrailingZeroBits(mask) >> 2);
+            }
+#endif
+        }
+        for (; x < to; ++x) {
+            if (isOpaque(line, x, alphaOffset, threshold)) return x;
+        }
+        return -1;
+    }
+
+    // last x in [from, to) with alpha >= threshold, or -1
+    int lastOpaque(const uchar* line, int from, int to, int alphaOffset, int threshold) {
+        int x = to;
+        if (alphaOffset == 3) {
+#ifdef IMAGETRIM_AVX2
+            const __m256i thr256 = _mm256_set1_epi8((char)threshold);
+            for (; x - 8 >= from; x -= 8) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line + (x - 8) * 4));
+                unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(v, thr256), v)) & 0x88888888u;
+                if (mask) return x - 8 + ((31 - qCountLeadingZeroBits(mask)) >> 2);
+            }
+#endif
+#ifdef IMAGETRIM_SSE2
+            const __m128i thr128 = _mm_set1_epi8((char)threshold);
+            for (; x - 4 >= from; x -= 4) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + (x - 4) * 4));
+                unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, thr128), v)) & 0x8888u;
+                if (mask) return x - 4 + ((31 - qCountLeadingZeroBits(mask)) >> 2);
+            }
+#endif
+        }
+        for (--x; x >= from; --x) {
+            if (isOpaque(line, x, alphaOffset, threshold)) return x;
+        }
+        return -1;
+    }
+
+}
+
+bool alphaBounds(const uchar* bits, int bytesPerLine, int width, int height, int alphaOffset, int threshold,
+                 int& left, int& top, int& right, int& bottom) {
+    left = width;
+    top = height;
+    right = 0;
+    bottom = 0;
+
+    // top: first row with any opaque pixel
+    int y0 = 0;
+    int x = -1;
+    for (; y0 < height; ++y0) {
+        x = firstOpaque(bits + y0 * bytesPerLine, 0, width, alphaOffset, threshold);
+        if (x >= 0) break;
+    }
+    if (y0 >= height) return false;
+
+    const uchar* line = bits + y0 * bytesPerLine;
+    top = y0;
+    left = x;
+    right = lastOpaque(line, x, width, alphaOffset, threshold);
+    bottom = y0;
+
+    // bottom: last row with any opaque pixel, scanning up
+    int y1 = height - 1;
+    for (; y1 > y0; --y1) {
+        line = bits + y1 * bytesPerLine;
+        x = firstOpaque(line, 0, width, alphaOffset, threshold);
+        if (x >= 0) {
+            bottom = y1;
+            if (x < left) left = x;
+            int xr = lastOpaque(line, right + 1, width, alphaOffset, threshold);
+            if (xr > right) right = xr;
+            break;
+        }
+    }
+
+    // rows in between: only the columns outside of the current bounds
+    for (int y = y0 + 1; y < bottom; ++y) {
+        if ((left == 0) && (right == width - 1)) break;
+
+        line = bits + y * bytesPerLine;
+        int xl = firstOpaque(line, 0, left, alphaOffset, threshold);
+        if (xl >= 0) left = xl;
+        int xr = lastOpaque(line, right + 1, width, alphaOffset, threshold);
+        if (xr >= 0) right = xr;
+    }
+
+    return true;
+}
+
+QRect alphaBounds(const QImage& image, int threshold) {
+    int alphaOffset = 0;
+    switch (image.format()) {
+        case QImage::Format_RGBA8888:
+        case QImage::Format_RGBA8888_Premultiplied:
+            alphaOffset = 3;
+            break;
+        case QImage::Format_ARGB32:
+        case QImage::Format_ARGB32_Premultiplied:
+            alphaOffset = (Q_BYTE_ORDER == Q_LITTLE_ENDIAN)? 3 : 0;
+            break;
+        default:
+            return alphaBounds(image.convertToFormat(QImage::Format_ARGB32), threshold);
+    }
+
+    int l, t, r, b;
+    alphaBounds(image.constBits(), image.bytesPerLine(), image.width(), image.height(), alphaOffset, threshold, l, t, r, b);
+    return QRect(QPoint(l, t), QPoint(r, b));
+}
@@ -0,0 +1,15 @@
+#ifndef IMAGETRIM_H
+#define IMAGETRIM_H
+
+#include <QImage>
+
+// Bounds of the pixels with alpha >= threshold, as QRect(QPoint(l, t), QPoint(r, b)).
+// A fully transparent image gives QRect(QPoint(width, height), QPoint(0, 0)),
+// same as the old per-pixel loop in PackContent::trim.
+QRect alphaBounds(const QImage& image, int threshold);
+
+// Raw kernel for 32-bit pixels, alphaOffset is the byte offset of alpha inside a pixel.
+bool alphaBounds(const uchar* bits, int bytesPerLine, int width, int height, int alphaOffset, int threshold,
+                 int& left, int& top, int& right, int& bottom);
+
+#endif // IMAGETRIM_H
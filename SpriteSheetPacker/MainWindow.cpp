@@ -87,6 +87,9 @@ MainWindow::MainWindow(QWidget *parent) :
     ui->pngOptLevelSlider->setVisible(false);
     ui->pngOptLevelText->setVisible(false);
     ui->pngOptLevelLabel->setVisible(false);
+    ui->pngQualityLabel->setVisible(false);
+    ui->pngQualityMinSpinBox->setVisible(false);
+    ui->pngQualityMaxSpinBox->setVisible(false);
 
     // layout preferences action on right side in toolbar
     QWidget* empty = new QWidget();
@@ -227,6 +230,8 @@ void MainWindow::refreshAtlas(bool generate) {
 
         _future = QtConcurrent::run([this]() {
             _mutex.lock();
+            // keep previous results, unchanged sprites stay at the same place
+            QVector<SpriteAtlas> previousAtlas = _spriteAtlas;
             _spriteAtlas.clear();
             for (int i=0; i<ui->scalingVariantsGroupBox->layout()->count(); ++i) {
                 ScalingVariantWidget* scalingVariantWidget = qobject_cast<ScalingVariantWidget*>(ui->scalingVariantsGroupBox->layout()->itemAt(i)->widget());
@@ -253,6 +258,10 @@ void MainWindow::refreshAtlas(bool generate) {
                         atlas.enablePolygonMode(true, ui->epsilonHorizontalSlider->value() / 10.f);
                     }
 
+                    if (i < previousAtlas.size()) {
+                        atlas.setPreviousAtlas(previousAtlas.at(i));
+                    }
+
                     SpriteAtlasGenerateProgress* progress = new SpriteAtlasGenerateProgress();
                     connect(progress, SIGNAL(progressTextChanged(const QString&)), this, SLOT(onRefreshAtlasProgressTextChanged(const QString&)));
 
@@ -353,6 +362,9 @@ void MainWindow::openSpritePackerProject(const QString& fileName) {
     ui->premultipliedCheckBox->setChecked(projectFile->premultiplied());
     ui->pngOptModeComboBox->setCurrentText(projectFile->pngOptMode());
     ui->pngOptLevelSlider->setValue(projectFile->pngOptLevel());
+    ui->pngQualityMinSpinBox->setValue(projectFile->pngQualityMin());
+    ui->pngQualityMaxSpinBox->setValue(projectFile->pngQualityMax());
+    ui->pngEncodeComboBox->setCurrentText(projectFile->pngEncodePreset());
     ui->webpQualitySlider->setValue(projectFile->webpQuality());
     ui->jpgQualitySlider->setValue(projectFile->jpgQuality());
 
@@ -429,6 +441,8 @@ void MainWindow::saveSpritePackerProject(const QString& fileName) {
     projectFile->setPremultiplied(ui->premultipliedCheckBox->isChecked());
     projectFile->setPngOptMode(ui->pngOptModeComboBox->currentText());
     projectFile->setPngOptLevel(ui->pngOptLevelSlider->value());
+    projectFile->setPngQuality(ui->pngQualityMinSpinBox->value(), ui->pngQualityMaxSpinBox->value());
+    projectFile->setPngEncodePreset(ui->pngEncodeComboBox->currentText());
     projectFile->setWebpQuality(ui->webpQualitySlider->value());
     projectFile->setJpgQuality(ui->jpgQualitySlider->value());
     projectFile->setTrimSpriteNames(ui->trimSpriteNamesCheckBox->isChecked());
@@ -650,6 +664,8 @@ void MainWindow::on_actionPublish_triggered() {
     publisher->setPixelFormat(pixelFormatFromString(ui->pixelFormatComboBox->currentText()));
     publisher->setPremultiplied(ui->premultipliedCheckBox->isChecked());
     publisher->setPngQuality(ui->pngOptModeComboBox->currentText(), ui->pngOptLevelSlider->value());
+    publisher->setPngQuantQuality(ui->pngQualityMinSpinBox->value(), ui->pngQualityMaxSpinBox->value());
+    publisher->setPngEncodePreset(ui->pngEncodeComboBox->currentText());
     publisher->setWebpQuality(ui->webpQualitySlider->value());
     publisher->setJpgQuality(ui->jpgQualitySlider->value());
     publisher->setTrimSpriteNames(ui->trimSpriteNamesCheckBox->isChecked());
@@ -728,28 +744,34 @@ void MainWindow::on_actionPublish_triggered() {
     }
 
     publishStatusDialog.log("Publish data and images...", Qt::darkGreen);
-    publisher->publish(ui->dataFormatComboBox->currentText());
+    QObject::connect(publisher, &PublishSpriteSheet::publishProgress, [&publishStatusDialog] (int done, int total, const QString& task) {
+        publishStatusDialog.log(QString("[%1/%2] %3").arg(done).arg(total).arg(task));
+    });
 
-    if (ui->pngOptModeComboBox->currentText() == "None") {
-        delete publisher;
-    } else {
+    if (ui->pngOptModeComboBox->currentText() != "None") {
         publishStatusDialog.log("PNG Optimization: optimize if needed.");
-        // TODO: you need to wait previous image optimization if they are the same
-        QObject::connect(publisher, &PublishSpriteSheet::onCompletedOptimizePNG, [this, publisher] () {
+        QObject::connect(publisher, &PublishSpriteSheet::onCompletedOptimizePNG, [this] () {
             // TODO: it would be good to show here for information about the optimization
             QMessageBox::information(this, "PNG Optimization", "PNG Optimization: complete.");
-            delete publisher;
         });
     }
 
-    publishStatusDialog.log(QString("Publishing is finished."), Qt::blue);
-    if (!publishStatusDialog.complete()) {
-        // This loop will wait for the window is finished
-        QEventLoop loop;
-        connect(&publishStatusDialog, SIGNAL(finished(int)), &loop, SLOT(quit()));
-        loop.exec();
-        qDebug() << "Finish publish";
+    // the tasks run on the publish pool, this loop keeps the dialog painting until they are
+    // done and the dialog is closed
+    QEventLoop loop;
+    connect(&publishStatusDialog, SIGNAL(finished(int)), &loop, SLOT(quit()));
+    QObject::connect(publisher, &PublishSpriteSheet::publishFinished, [&publishStatusDialog, publisher] (bool) {
+        publisher->deleteLater();
+        publishStatusDialog.log(QString("Publishing is finished."), Qt::blue);
+        publishStatusDialog.complete();
+    });
+    if (!publisher->publish(ui->dataFormatComboBox->currentText())) {
+        delete publisher;
+        publishStatusDialog.log(QString("Publishing is finished."), Qt::blue);
+        if (publishStatusDialog.complete()) return;
     }
+    loop.exec();
+    qDebug() << "Finish publish";
 }
 
 void MainWindow::on_actionPreferences_triggered() {
@@ -865,12 +887,40 @@ void MainWindow::on_addScalingVariantPushButton_clicked() {
 }
 
 void MainWindow::on_pngOptModeComboBox_currentTextChanged(const QString &text) {
-    bool visible = (text == "Lossless");
+    // the level is the trial count for Lossless and the quantization speed for Lossy
+    bool visible = (text != "None");
 
     ui->pngOptLevelSlider->setVisible(visible);
     ui->pngOptLevelText->setVisible(visible);
     ui->pngOptLevelLabel->setVisible(visible);
 
+    ui->pngQualityLabel->setVisible(text == "Lossy");
+    ui->pngQualityMinSpinBox->setVisible(text == "Lossy");
+    ui->pngQualityMaxSpinBox->setVisible(text == "Lossy");
+
+    // the optimizers do their own encoding
+    ui->pngEncodeComboBox->setVisible(text == "None");
+    ui->pngEncodeLabel->setVisible(text == "None");
+
+    setProjectDirty();
+}
+
+void MainWindow::on_pngEncodeComboBox_currentTextChanged(const QString&) {
+    setProjectDirty();
+}
+
+void MainWindow::on_pngQualityMinSpinBox_valueChanged(int value) {
+    // keep a valid range, the maximum follows the minimum
+    if (ui->pngQualityMaxSpinBox->value() < value) {
+        ui->pngQualityMaxSpinBox->setValue(value);
+    }
+    setProjectDirty();
+}
+
+void MainWindow::on_pngQualityMaxSpinBox_valueChanged(int value) {
+    if (ui->pngQualityMinSpinBox->value() > value) {
+        ui->pngQualityMinSpinBox->setValue(value);
+    }
     setProjectDirty();
 }
 
@@ -912,7 +962,7 @@ void MainWindow::on_rotateSpritesCheckBox_toggled() {
 }
 
 void MainWindow::on_algorithmComboBox_currentTextChanged(const QString& text) {
-    if (text == "Polygon") {
+    if (text.startsWith("Polygon")) {
         ui->trimModeComboBox->setCurrentText("Polygon");
     }
 
@@ -79,6 +79,9 @@ private slots:
     void on_destPathLineEdit_textChanged(const QString& text);
     void on_spriteSheetLineEdit_textChanged(const QString& text);
     void on_pngOptModeComboBox_currentTextChanged(const QString &text);
+    void on_pngEncodeComboBox_currentTextChanged(const QString &text);
+    void on_pngQualityMinSpinBox_valueChanged(int value);
+    void on_pngQualityMaxSpinBox_valueChanged(int value);
     void on_premultipliedCheckBox_toggled();
 
     void onScalingVariantWidgetValueChanged(bool);
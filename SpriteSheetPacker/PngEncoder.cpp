@@ -0,0 +1,200 @@
+#include "PngEncoder.h"
+#include <QtConcurrent>
+#include "zlib.h"
+
+namespace {
+
+    // input of a zlib stream is cut in blocks of this size when deflating in parallel
+    const size_t DEFLATE_BLOCK_SIZE = 256 * 1024;
+    // every block is primed with the end of the previous one, like pigz does
+    const size_t DEFLATE_DICTIONARY_SIZE = 32768;
+
+    struct DeflateBlock {
+        const unsigned char*    data;
+        size_t                  size;
+        size_t                  dictionarySize; // bytes right before data
+        bool                    last;
+        QByteArray              output;
+        uLong                   adler;
+        bool                    ok;
+    };
+
+    // raw deflate of one block, ends on a byte boundary (sync flush) unless it is the last one
+    void deflateBlock(DeflateBlock& block, int level, int strategy, int memLevel) {
+        block.ok = false;
+        block.adler = adler32(adler32(0L, Z_NULL, 0), block.data, block.size);
+
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        if (deflateInit2(&stream, level, Z_DEFLATED, -15, memLevel, strategy) != Z_OK) {
+            return;
+        }
+        if (block.dictionarySize) {
+            deflateSetDictionary(&stream, block.data - block.dictionarySize, block.dictionarySize);
+        }
+
+        block.output.resize(deflateBound(&stream, block.size) + 16);
+        stream.next_in = const_cast<Bytef*>(block.data);
+        stream.avail_in = block.size;
+        stream.next_out = reinterpret_cast<Bytef*>(block.output.data());
+        stream.avail_out = block.output.size();
+
+        int result = deflate(&stream, block.last? Z_FINISH : Z_SYNC_FLUSH);
+        block.ok = block.last? (result == Z_STREAM_END) : ((result == Z_OK) && (stream.avail_in == 0) && (stream.avail_out > 0));
+        block.output.resize(stream.total_out);
+        deflateEnd(&stream);
+    }
+
+    // the two byte zlib header deflateInit would write for these settings
+    void zlibHeader(unsigned char header[2], int level, int strategy) {
+        unsigned int levelFlags = 3;
+        if ((strategy >= Z_HUFFMAN_ONLY) || (level < 2)) {
+            levelFlags = 0;
+        } else if (level < 6) {
+            levelFlags = 1;
+        } else if (level == 6) {
+            levelFlags = 2;
+        }
+        unsigned int value = ((Z_DEFLATED + ((15 - 8) << 4)) << 8) | (levelFlags << 6);
+        value += 31 - (value % 31);
+        header[0] = value >> 8;
+        header[1] = value & 0xff;
+    }
+
+    unsigned zlibCompressParallel(unsigned char** out, size_t* outsize, const unsigned char* in, size_t insize, const PngEncodeSettings& settings) {
+        QVector<DeflateBlock> blocks;
+        for (size_t offset = 0; offset < insize; offset += DEFLATE_BLOCK_SIZE) {
+            DeflateBlock block;
+            block.data = in + offset;
+            block.size = qMin(DEFLATE_BLOCK_SIZE, insize - offset);
+            block.dictionarySize = qMin(DEFLATE_DICTIONARY_SIZE, offset);
+            block.last = (offset + block.size == insize);
+            blocks.push_back(block);
+        }
+
+        QtConcurrent::blockingMap(blocks, [&settings](DeflateBlock& block) {
+            deflateBlock(block, settings.zlibLevel, settings.zlibStrategy, settings.zlibMemLevel);
+        });
+
+        size_t size = 2 + 4;
+        uLong adler = adler32(0L, Z_NULL, 0);
+        for (const DeflateBlock& block: blocks) {
+            if (!block.ok) {
+                return 1;
+            }
+            size += block.output.size();
+            adler = adler32_combine(adler, block.adler, block.size);
+        }
+
+        *out = (unsigned char*)malloc(size);
+        if (!*out) {
+            return 1;
+        }
+
+        unsigned char* pos = *out;
+        zlibHeader(pos, settings.zlibLevel, settings.zlibStrategy);
+        pos += 2;
+        for (const DeflateBlock& block: blocks) {
+            memcpy(pos, block.output.constData(), block.output.size());
+            pos += block.output.size();
+        }
+        pos[0] = (adler >> 24) & 0xff;
+        pos[1] = (adler >> 16) & 0xff;
+        pos[2] = (adler >> 8) & 0xff;
+        pos[3] = adler & 0xff;
+        *outsize = size;
+
+        return 0;
+    }
+
+    unsigned zlibCompressSingle(unsigned char** out, size_t* outsize, const unsigned char* in, size_t insize, const PngEncodeSettings& settings) {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        if (deflateInit2(&stream, settings.zlibLevel, Z_DEFLATED, 15, settings.zlibMemLevel, settings.zlibStrategy) != Z_OK) {
+            return 1;
+        }
+
+        uLong bound = deflateBound(&stream, insize);
+        *out = (unsigned char*)malloc(bound);
+        if (!*out) {
+            deflateEnd(&stream);
+            return 1;
+        }
+
+        stream.next_in = const_cast<Bytef*>(in);
+        stream.avail_in = insize;
+        stream.next_out = *out;
+        stream.avail_out = bound;
+        int result = deflate(&stream, Z_FINISH);
+        *outsize = stream.total_out;
+        deflateEnd(&stream);
+
+        return (result == Z_STREAM_END)? 0 : 1;
+    }
+
+    // lodepng custom_zlib backed by the vendored zlib, custom_context is the PngEncodeSettings
+    unsigned zlibCompress(unsigned char** out, size_t* outsize, const unsigned char* in, size_t insize, const LodePNGCompressSettings* zlibsettings) {
+        const PngEncodeSettings& settings = *static_cast<const PngEncodeSettings*>(zlibsettings->custom_context);
+        if (settings.parallelDeflate && (insize > 2 * DEFLATE_BLOCK_SIZE)) {
+            return zlibCompressParallel(out, outsize, in, insize, settings);
+        }
+        return zlibCompressSingle(out, outsize, in, insize, settings);
+    }
+
+}
+
+void setPngEncodeZlib(LodePNGState* state, const PngEncodeSettings* settings) {
+    state->encoder.zlibsettings.custom_zlib = zlibCompress;
+    state->encoder.zlibsettings.custom_context = settings;
+}
+
+PngEncodeSettings PngEncodeSettings::fromPreset(const QString& preset) {
+    if (preset == "Fast") {
+        return PngEncodeSettings{ 1, Z_DEFAULT_STRATEGY, 9, LFS_MINSUM, false, true };
+    } else if (preset == "Max") {
+        return PngEncodeSettings{ 9, Z_DEFAULT_STRATEGY, 9, LFS_ENTROPY, true, false };
+    }
+    return PngEncodeSettings{ 6, Z_DEFAULT_STRATEGY, 9, LFS_MINSUM, true, true };
+}
+
+bool encodePng(const QImage& image, const PngEncodeSettings& settings, QByteArray& png) {
+    // grey images (the JPG_PNG alpha mask) stay one channel even without auto_convert
+    const bool grey = (image.format() == QImage::Format_Grayscale8);
+    QImage img = grey? image : image.convertToFormat(QImage::Format_RGBA8888);
+
+    // lodepng wants rows without padding, only grey rows can have it
+    QByteArray packed;
+    const unsigned char* pixels = img.constBits();
+    if (grey && (img.bytesPerLine() != img.width())) {
+        packed.resize(img.width() * img.height());
+        for (int y = 0; y < img.height(); ++y) {
+            memcpy(packed.data() + y * img.width(), img.constScanLine(y), img.width());
+        }
+        pixels = reinterpret_cast<const unsigned char*>(packed.constData());
+    }
+
+    LodePNGState state;
+    lodepng_state_init(&state);
+    if (grey) {
+        state.info_raw.colortype = LCT_GREY;
+        state.info_png.color.colortype = LCT_GREY;
+    }
+    state.encoder.add_id = false;
+    state.encoder.auto_convert = settings.autoConvert;
+    state.encoder.filter_strategy = settings.filterStrategy;
+    setPngEncodeZlib(&state, &settings);
+
+    unsigned char* compressed = NULL;
+    size_t compressed_size = 0;
+    unsigned error = lodepng_encode(&compressed, &compressed_size, pixels, img.width(), img.height(), &state);
+    if (!error) {
+        png = QByteArray((const char*)compressed, (int)compressed_size);
+    } else {
+        qWarning() << "PNG encode error:" << lodepng_error_text(error);
+    }
+
+    lodepng_state_cleanup(&state);
+    free(compressed);
+
+    return !error;
+}
@@ -0,0 +1,31 @@
+#ifndef PNGENCODER_H
+#define PNGENCODER_H
+
+#include <QtCore>
+#include <QImage>
+#include "lodepng.h"
+
+// How publish encodes PNG files that are not optimized afterwards:
+// Fast      - zlib level 1, blocks deflated in parallel, no color type reduction.
+// Balanced  - zlib level 6, blocks deflated in parallel, lossless color type reduction.
+// Max       - zlib level 9 in a single stream, entropy filter heuristic, color type reduction.
+struct PngEncodeSettings {
+    int                     zlibLevel;
+    int                     zlibStrategy;
+    int                     zlibMemLevel;       // 1-9, 9 uses the most memory and compresses best
+    LodePNGFilterStrategy   filterStrategy;     // filter heuristic, chosen per row
+    bool                    autoConvert;
+    bool                    parallelDeflate;    // pigz style independent blocks
+
+    static PngEncodeSettings fromPreset(const QString& preset);
+    static QStringList presets() { return QStringList() << "Fast" << "Balanced" << "Max"; }
+};
+
+// Makes the lodepng encoder of state deflate with the vendored zlib and these settings,
+// for callers that fill the state themselves. settings must outlive the encode.
+void setPngEncodeZlib(LodePNGState* state, const PngEncodeSettings* settings);
+
+// Encodes the image to png bytes. Grayscale8 is written as grey, other formats as RGBA8888.
+bool encodePng(const QImage& image, const PngEncodeSettings& settings, QByteArray& png);
+
+#endif // PNGENCODER_H
@@ -2,7 +2,92 @@
 #include <QtDebug>
 #include <QtCore>
 #include "lodepng.h"
+#include "zlib.h"
+#include "PngEncoder.h"
 #include <QImage>
+#include <QtConcurrent>
+
+namespace {
+
+    // one optipng trial, filter 0-4 is used on every row and 5 is the adaptive heuristic
+    struct OptiPngTrial {
+        int                 filter;
+        PngEncodeSettings   settings;
+    };
+
+    QVector<int> range(int first, int last) {
+        QVector<int> values;
+        for (int value = first; value <= last; ++value) {
+            values.push_back(value);
+        }
+        return values;
+    }
+
+    // the trials opnglib runs for an optimization level, from the presets in opngcore/optim.c.
+    // Levels without a preset use its guess, which depends on whether the image gets filtered.
+    QVector<OptiPngTrial> optiPngTrials(int optLevel, bool filtered) {
+        if (optLevel == 0) {
+            optLevel = OPNG_OPTIM_LEVEL_DEFAULT;
+        }
+        optLevel = qBound<int>(OPNG_OPTIM_LEVEL_MIN, optLevel, OPNG_OPTIM_LEVEL_MAX);
+
+        QVector<int> filters = (optLevel <= 1)? QVector<int>{ filtered? 5 : 0 } : (optLevel <= 3)? QVector<int>{ 0, 5 } : range(0, 5);
+        QVector<int> levels = (optLevel == -2)? QVector<int>{ 3 } : (optLevel <= 4)? QVector<int>{ 9 } : range((optLevel == 5)? 3 : 1, 9);
+        QVector<int> memLevels = (optLevel <= 2)? QVector<int>{ filtered? 9 : 8 } : range((optLevel == 6)? 7 : 8, 9);
+        QVector<int> strategies = (optLevel <= 1)? QVector<int>{ filtered? Z_FILTERED : Z_DEFAULT_STRATEGY } : range(Z_DEFAULT_STRATEGY, Z_RLE);
+
+        QVector<OptiPngTrial> trials;
+        for (int filter: filters) {
+            for (int strategy: strategies) {
+                // the level has no meaning for huffman only and rle
+                QVector<int> strategyLevels = levels;
+                if (strategy == Z_HUFFMAN_ONLY) {
+                    strategyLevels = { 1 };
+                } else if (strategy == Z_RLE) {
+                    strategyLevels = { 9 };
+                }
+                for (int level: strategyLevels) {
+                    for (int memLevel: memLevels) {
+                        trials.push_back({ filter, { level, strategy, memLevel, LFS_MINSUM, true, false } });
+                    }
+                }
+            }
+        }
+        return trials;
+    }
+
+    bool encodeTrial(const QImage& image, const OptiPngTrial& trial, QByteArray& png) {
+        LodePNGState state;
+        lodepng_state_init(&state);
+        state.encoder.add_id = false;
+        state.encoder.auto_convert = trial.settings.autoConvert;
+        // optipng filters palette images too when the trial says so
+        state.encoder.filter_palette_zero = false;
+
+        QByteArray filters;
+        if (trial.filter == 5) {
+            state.encoder.filter_strategy = LFS_MINSUM;
+        } else {
+            filters.fill(trial.filter, image.height());
+            state.encoder.filter_strategy = LFS_PREDEFINED;
+            state.encoder.predefined_filters = reinterpret_cast<const unsigned char*>(filters.constData());
+        }
+        setPngEncodeZlib(&state, &trial.settings);
+
+        unsigned char* compressed = NULL;
+        size_t compressed_size = 0;
+        bool result = (lodepng_encode(&compressed, &compressed_size, image.constBits(), image.width(), image.height(), &state) == 0);
+        if (result) {
+            png = QByteArray((const char*)compressed, (int)compressed_size);
+        }
+
+        lodepng_state_cleanup(&state);
+        free(compressed);
+
+        return result;
+    }
+
+}
 
 OptiPngOptimizer::OptiPngOptimizer(int optLevel) {
     _optLevel = optLevel;
@@ -25,17 +110,6 @@ OptiPngOptimizer::~OptiPngOptimizer() {
     opng_destroy_transformer(transformer);
 }
 
-bool OptiPngOptimizer::optimizeFiles(const QStringList& fileNames) {
-
-    for(const QString& fileName : fileNames) {
-        if (!optimizeFile(fileName)) {
-            continue;
-        }
-    }
-
-    return true;
-}
-
 bool OptiPngOptimizer::optimizeFile(const QString& fileName) {
 
     if (opng_optimize_file(optimizer,
@@ -48,6 +122,42 @@ bool OptiPngOptimizer::optimizeFile(const QString& fileName) {
     return true;
 }
 
+bool OptiPngOptimizer::optimizeImage(const QImage& source, QByteArray& png) {
+    QImage image = source.convertToFormat(QImage::Format_RGBA8888);
+
+    // optipng's trials in memory, on the color type lodepng reduces the image to
+    LodePNGColorMode rawMode;
+    LodePNGColorMode pngMode;
+    lodepng_color_mode_init(&rawMode);
+    lodepng_color_mode_init(&pngMode);
+    if (lodepng_auto_choose_color(&pngMode, image.constBits(), image.width(), image.height(), &rawMode)) {
+        lodepng_color_mode_cleanup(&pngMode);
+        return false;
+    }
+    const bool filtered = (pngMode.bitdepth >= 8) && (pngMode.colortype != LCT_PALETTE);
+    lodepng_color_mode_cleanup(&pngMode);
+
+    // the trials are independent, the smallest wins and the first one on equal sizes
+    const QVector<OptiPngTrial> trials = optiPngTrials(_optLevel, filtered);
+    QVector<int> indices = range(0, trials.size() - 1);
+    QMutex mutex;
+    int bestIndex = -1;
+    png.clear();
+    QtConcurrent::blockingMap(indices, [&](int index) {
+        QByteArray trialPng;
+        if (!encodeTrial(image, trials.at(index), trialPng)) {
+            return;
+        }
+        QMutexLocker locker(&mutex);
+        if ((bestIndex < 0) || (trialPng.size() < png.size()) || ((trialPng.size() == png.size()) && (index < bestIndex))) {
+            png = trialPng;
+            bestIndex = index;
+        }
+    });
+
+    return !png.isEmpty();
+}
+
 bool OptiPngOptimizer::setOptions(int optLevel) {
     _optLevel = optLevel;
 
@@ -61,68 +171,82 @@ bool OptiPngOptimizer::setOptions(int optLevel) {
 }
 
 PngQuantOptimizer::PngQuantOptimizer(int optLevel) {
-    _optLevel = optLevel;
-
     attr = liq_attr_create();
+
+    setOptions(optLevel);
 }
 
 PngQuantOptimizer::~PngQuantOptimizer() {
     liq_attr_destroy(attr);
-
-    if (image) {
-        liq_image_destroy(image);
-    }
-
-    if (res) {
-        liq_result_destroy(res);
-    }
 }
 
-bool PngQuantOptimizer::optimizeFiles(const QStringList& fileNames) {
-
-    for(const QString& fileName : fileNames) {
-        if (!optimizeFile(fileName)) {
-            continue;
-        }
+bool PngQuantOptimizer::optimizeImage(const QImage& source, QByteArray& png) {
+    QVector<QByteArray> pngs;
+    if (!optimizeImages(QVector<QImage>() << source, pngs)) {
+        return false;
     }
 
+    png = pngs.first();
     return true;
 }
 
-bool PngQuantOptimizer::optimizeFile(const QString& fileName) {
-    unsigned int width, height = 0;
-    unsigned char *compressed = NULL;
-    size_t compressed_size = 0;
-
-    QImage img(fileName);
-    img = img.convertToFormat(QImage::Format_RGBA8888);
-
-    width = img.width();
-    height = img.height();
-
-    LodePNGState state;
-    lodepng_state_init(&state);
-
-    image = liq_image_create_rgba(attr, img.bits(), width, height, 0);
-    liq_set_speed(attr, 1);
+bool PngQuantOptimizer::optimizeImages(const QVector<QImage>& sources, QVector<QByteArray>& pngs) {
+    QVector<QImage> images;
+    for (const QImage& source: sources) {
+        images.push_back(source.convertToFormat(QImage::Format_RGBA8888));
+    }
 
-    res = liq_quantize_image(attr, image);
+    // one histogram of all images, so they are quantized once and share the palette
+    liq_histogram* histogram = liq_histogram_create(attr);
+    bool result = (histogram != NULL);
+    for (int i = 0; result && (i < images.size()); ++i) {
+        liq_image* image = liq_image_create_rgba(attr, images[i].constBits(), images[i].width(), images[i].height(), 0);
+        result = image && (liq_histogram_add_image(histogram, attr, image) == LIQ_OK);
+        if (image) {
+            liq_image_destroy(image);
+        }
+    }
 
-    if (!res) return false;
+    liq_result* res = NULL;
+    if (result) {
+        result = (liq_histogram_quantize(histogram, attr, &res) == LIQ_OK);
+    }
+    if (histogram) {
+        liq_histogram_destroy(histogram);
+    }
+    if (!result) {
+        return false;
+    }
 
     liq_set_dithering_level(res, 1.0f);
 
-    int buffer_size = width * height;
-    unsigned char* buffer = (unsigned char*)malloc(buffer_size);
+    pngs.clear();
+    for (int i = 0; result && (i < images.size()); ++i) {
+        liq_image* image = liq_image_create_rgba(attr, images[i].constBits(), images[i].width(), images[i].height(), 0);
+        QByteArray png;
+        result = image && encodeRemapped(res, image, images[i].width(), images[i].height(), png);
+        if (image) {
+            liq_image_destroy(image);
+        }
+        pngs.push_back(png);
+    }
+
+    liq_result_destroy(res);
 
-    if (liq_write_remapped_image(res, image, buffer, buffer_size) != LIQ_OK) {
-        free(buffer);
+    return result;
+}
 
+bool PngQuantOptimizer::encodeRemapped(liq_result* res, liq_image* image, int width, int height, QByteArray& png) {
+    QByteArray buffer(width * height, 0);
+    if (liq_write_remapped_image(res, image, buffer.data(), buffer.size()) != LIQ_OK) {
         return false;
     }
 
     const liq_palette* pal = liq_get_palette(res);
 
+    LodePNGState state;
+    lodepng_state_init(&state);
+
     state.info_raw.colortype = LCT_PALETTE;
     state.info_raw.bitdepth = 8;
     state.info_png.color.colortype = LCT_PALETTE;
@@ -131,27 +255,35 @@ bool PngQuantOptimizer::optimizeFile(const QString& fileName) {
 
     // png compression
     state.encoder.add_id = false;
-    state.encoder.zlibsettings.nicematch = 258;
-    state.encoder.zlibsettings.lazymatching = 1;
-    state.encoder.zlibsettings.windowsize = 32768;
+    PngEncodeSettings settings = { Z_BEST_COMPRESSION, Z_DEFAULT_STRATEGY, 9, LFS_ZERO, false, true };
+    setPngEncodeZlib(&state, &settings);
 
     for(unsigned int i = 0; i < pal->count; i++) {
         lodepng_palette_add(&state.info_png.color, pal->entries[i].r, pal->entries[i].g, pal->entries[i].b, pal->entries[i].a);
         lodepng_palette_add(&state.info_raw, pal->entries[i].r, pal->entries[i].g, pal->entries[i].b, pal->entries[i].a);
     }
 
-    lodepng_encode(&compressed, &compressed_size, buffer, width, height, &state);
-    lodepng_save_file(compressed, compressed_size, fileName.toStdString().c_str());
+    unsigned char *compressed = NULL;
+    size_t compressed_size = 0;
+    bool result = (lodepng_encode(&compressed, &compressed_size, (const unsigned char*)buffer.constData(), width, height, &state) == 0);
+    if (result) {
+        png = QByteArray((const char*)compressed, (int)compressed_size);
+    }
 
     lodepng_state_cleanup(&state);
-    free(buffer);
     free(compressed);
 
-    return true;
+    return result;
+}
+
+bool PngQuantOptimizer::setQuality(int minimum, int maximum) {
+    return liq_set_quality(attr, minimum, maximum) == LIQ_OK;
 }
 
 bool PngQuantOptimizer::setOptions(int optLevel) {
     _optLevel = optLevel;
 
-    return true;
+    // without a level (below 0) keep speed 1, the speed used before there were levels
+    int speed = (_optLevel < 0) ? 1 : qBound(1, 7 - _optLevel, 7);
+    return liq_set_speed(attr, speed) == LIQ_OK;
 }
@@ -2,6 +2,7 @@
 #define PNGOPTIMIZER_H
 
 #include <QtCore>
+#include <QImage>
 #include "opnglib.h"
 #include "libimagequant.h"
 
@@ -11,8 +12,9 @@ public:
     ~PngOptimizer() {}
 	
 public:
-    virtual bool optimizeFiles(const QStringList&) { return true; }
     virtual bool optimizeFile(const QString&) { return true; }
+    // optimized png bytes of the image, the caller writes them
+    virtual bool optimizeImage(const QImage&, QByteArray&) { return false; }
 
     virtual bool setOptions(int) { return true; }
 };
@@ -23,8 +25,10 @@ public:
     OptiPngOptimizer(int optLevel = 0);
     ~OptiPngOptimizer();
 
-    bool optimizeFiles(const QStringList& fileNames) override;
+    // runs opnglib on a png file in place
     bool optimizeFile(const QString& fileName) override;
+    // runs the same trials as opnglib in memory, the caller writes the png once
+    bool optimizeImage(const QImage& image, QByteArray& png) override;
 
     bool setOptions(int optLevel) override;
 
@@ -42,17 +46,22 @@ public:
     PngQuantOptimizer(int optLevel = 0);
     ~PngQuantOptimizer();
 
-    bool optimizeFiles(const QStringList& fileNames) override;
-    bool optimizeFile(const QString& fileName) override;
+    bool optimizeImage(const QImage& image, QByteArray& png) override;
+    // quantizes all images with one palette built from their pooled histogram,
+    // for the pages of a sprite sheet
+    bool optimizeImages(const QVector<QImage>& images, QVector<QByteArray>& pngs);
 
+    // levels 0-6 map to liq speed 7-1
     bool setOptions(int optLevel) override;
+    // 0-100, quantization fails when the maximum can't be reached with the minimum
+    bool setQuality(int minimum, int maximum);
 
 private:
+    bool encodeRemapped(liq_result* res, liq_image* image, int width, int height, QByteArray& png);
+
     int _optLevel;
 
     liq_attr* attr;
-    liq_image* image;
-    liq_result* res;
 };
 
 #endif // PNGOPTIMIZER_H
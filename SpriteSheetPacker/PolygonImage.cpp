@@ -2,6 +2,7 @@
 #include "PolygonImage.h"
 #include "clipper.hpp"
 #include "poly2tri.h"
+#include <algorithm>
 
 const static float PRECISION = 10.f;
 
@@ -21,89 +22,91 @@ PolygonImage::PolygonImage(const QImage& image, const QRectF& rect, const float
     , _height(image.height())
     , _threshold(threshold)
 {
-    _image = image.convertToFormat(QImage::Format_RGBA8888);
-
     QRectF realRect = rect;
-
-    // find first bigger
-    double area_big = 0;
-    std::vector<QPointF> p_big;
-    {
-        auto p = trace(realRect, threshold);
-        while (p.size() >= 3) {
-            std::vector<QPointF> polyPoint = p;
-            if (polyPoint.size() >= 9) {
-                polyPoint = reduce(polyPoint, realRect, epsilon);
+    buildMask(image, realRect, threshold);
+
+    // trace the outer contour of every island once, in scan order
+    struct Island {
+        QPointF start;
+        bool edge;
+        std::vector<QPointF> contour;
+        std::vector<QPointF> polygon;
+        QPolygonF fill;
+        double area;
+    };
+    std::vector<Island> islands;
+    for (const auto& start: findIslands()) {
+        Island island;
+        island.start = start;
+        island.edge = _mask[getMaskIndex(start.x(), start.y())] & MASK_EDGE;
+        island.area = 0;
+        if (!island.edge) {
+            island.contour = marchSquare(realRect, start);
+            island.polygon = island.contour;
+            if (island.polygon.size() >= 9) {
+                island.polygon = reduce(island.polygon, realRect, epsilon);
             }
-            if (polyPoint.size() >= 3) {
-                polyPoint = expand(polyPoint, realRect, epsilon);
+            if (island.polygon.size() >= 3) {
+                island.polygon = expand(island.polygon, realRect, epsilon);
             }
-
-            // erase contour for find next
-            QPolygonF fillPolygon(QVector<QPointF>::fromStdVector(polyPoint));
-            fillPolygon.translate(rect.x(), rect.y());
-            QColor fillColor(0, 0, 0, 0);
-            QPen pen(fillColor);
-            pen.setWidthF(2);//qMax(epsilon, 2.f));
-            QPainter painer(&_image);
-            painer.setPen(pen);
-            painer.setBrush(QBrush(fillColor));
-            painer.setCompositionMode(QPainter::CompositionMode_Source);
-            painer.drawPolygon(fillPolygon);
-            painer.end();
+            island.fill = QPolygonF(QVector<QPointF>::fromStdVector(island.polygon));
 
             // calculate area of polygon
-            if (polyPoint.size() >= 3) {
+            if (island.polygon.size() >= 3) {
                 ClipperLib::Path poly;
-                for(auto it = polyPoint.begin(); it<polyPoint.end(); ++it) {
+                for(auto it = island.polygon.begin(); it<island.polygon.end(); ++it) {
                     poly << ClipperLib::IntPoint(it->x()* PRECISION, it->y() * PRECISION);
                 }
-                double area = fabs(ClipperLib::Area(poly));
-                if (area > area_big) {
-                    p_big = p;
-                    area_big = area;
-                }
+                island.area = fabs(ClipperLib::Area(poly));
             }
-
-            // next
-            p = trace(realRect, threshold);
         }
+        islands.push_back(island);
     }
 
-    if (p_big.size() < 3) return;
-
-    // reinit image
-    _image = image.convertToFormat(QImage::Format_RGBA8888);
-
-    // finding all polygons (start with bigger)
-    auto p = p_big;
-    while (p.size() >= 3) {
-        if (p.size() >= 9) {
-            p = reduce(p, realRect, epsilon);
-        }
-        if (p.size() >= 3) {
-            p = expand(p, realRect, epsilon);
+    // picks islands the same way as tracing, erasing the polygon from the image and searching
+    // the next opaque pixel from the top did: islands inside of a taken polygon are skipped,
+    // and an opaque pixel left in the untraced last row or column ends the search
+    auto takeIslands = [&islands, &realRect](std::vector<size_t> taken) {
+        auto isCovered = [&islands, &taken](const std::vector<QPointF>& points) {
+            for (auto index: taken) {
+                const QPolygonF& fill = islands[index].fill;
+                if (std::all_of(points.begin(), points.end(), [&fill](const QPointF& point) {
+                    return fill.containsPoint(point, Qt::OddEvenFill);
+                })) return true;
+            }
+            return false;
+        };
+        for (size_t i=0; i<islands.size(); ++i) {
+            const Island& island = islands[i];
+            if (island.edge) {
+                QPointF center = island.start - realRect.topLeft() + QPointF(0.5, 0.5);
+                if (isCovered({center})) continue;
+                break;
+            }
+            if (std::find(taken.begin(), taken.end(), i) != taken.end()) continue;
+            if (island.contour.size() < 3) break;
+            if (isCovered(island.contour)) continue;
+            taken.push_back(i);
         }
+        return taken;
+    };
 
-        // erase contour for find next
-        QPolygonF fillPolygon(QVector<QPointF>::fromStdVector(p));
-        fillPolygon.translate(rect.x(), rect.y());
-        QColor fillColor(0, 0, 0, 0);
-        QPen pen(fillColor);
-        pen.setWidthF(2);//qMax(epsilon * 2, 10.f));
-        QPainter painer(&_image);
-        painer.setPen(pen);
-        painer.setBrush(QBrush(fillColor));
-        painer.setCompositionMode(QPainter::CompositionMode_Source);
-        painer.drawPolygon(fillPolygon);
-        painer.end();
-
-        if (p.size() >= 3) {
-            _polygons.push_back(p);
+    // find first bigger
+    double area_big = 0;
+    size_t big = 0;
+    for (auto index: takeIslands(std::vector<size_t>())) {
+        if (islands[index].area > area_big) {
+            big = index;
+            area_big = islands[index].area;
         }
+    }
+    if (area_big <= 0) return;
 
-        // find next
-        p = trace(realRect, threshold);
+    // finding all polygons (start with bigger)
+    for (auto index: takeIslands(std::vector<size_t>(1, big))) {
+        if (islands[index].polygon.size() >= 3) {
+            _polygons.push_back(islands[index].polygon);
+        }
     }
 
     // combine all polygons if posible
@@ -130,42 +133,80 @@ PolygonImage::PolygonImage(const QImage& image, const QRectF& rect, const float
         if (tri.indices.size()) {
             _triangles.add(tri);
         }
-        _triangles.debugPoints.insert(_triangles.debugPoints.end(), (*it_p1).begin(), (*it_p1).end());
         ++it_p1;
     }
 }
 
-std::vector<QPointF> PolygonImage::trace(const QRectF& rect, const float& threshold) {
-    auto result = findFirstNoneTransparentPixel(rect, threshold);
-    if (result.first) {
-        return marchSquare(rect, result.second, threshold);
-    } else {
-        return std::vector<QPointF>();
+void PolygonImage::buildMask(const QImage& image, const QRectF& rect, const float& threshold) {
+    const int left = qMax((int)rect.left(), 0);
+    const int top = qMax((int)rect.top(), 0);
+    const int right = qMin((int)(rect.left() + rect.width()) - 1, (int)_width - 1);
+    const int bottom = qMin((int)(rect.top() + rect.height()) - 1, (int)_height - 1);
+    // NOTE: due to the way we pick points from texture, the last row and column of rect are left out of tracing
+    const int traceRight = (int)(rect.left() + rect.width()) - 2;
+    const int traceBottom = (int)(rect.top() + rect.height()) - 2;
+
+    _maskLeft = left;
+    _maskTop = top;
+    _maskWidth = qMax(right - left + 1, 0);
+    _maskHeight = qMax(bottom - top + 1, 0);
+
+    // one transparent pixel of padding on every side, so a square at the border never reads outside
+    _maskStride = _maskWidth + 2;
+    _mask.assign(_maskStride * (_maskHeight + 2), 0);
+    _visited.assign(_mask.size(), 0);
+    if (!_maskWidth || !_maskHeight) return;
+
+    QImage source = image.convertToFormat(QImage::Format_RGBA8888);
+    for (int y=0; y<_maskHeight; ++y) {
+        const uchar* line = source.constScanLine(top + y) + left * 4;
+        unsigned char* mask = &_mask[(y + 1) * _maskStride + 1];
+        for (int x=0; x<_maskWidth; ++x) {
+            if (line[x * 4 + 3] > threshold) {
+                mask[x] = ((left + x > traceRight) || (top + y > traceBottom))? MASK_EDGE : MASK_SOLID;
+            }
+        }
     }
 }
 
-QPair<bool, QPointF> PolygonImage::findFirstNoneTransparentPixel(const QRectF& rect, const float& threshold) {
-    QPointF i;
-    for(i.ry() = rect.top(); i.y() < rect.bottom(); i.ry()++) {
-        for(i.rx() = rect.left(); i.x() < rect.right(); i.rx()++) {
-            auto alpha = getAlphaByPos(i);
-            if(alpha > threshold) {
-                return qMakePair(true, i);
+std::vector<QPointF> PolygonImage::findIslands() {
+    std::vector<QPointF> starts;
+
+    // flood fill 8-connected islands in scan order (same as marching squares walks around them),
+    // the first pixel of each is where its contour starts. Opaque pixels of the untraced last row
+    // and column are returned one by one
+    std::vector<int> stack;
+    for (int y=0; y<_maskHeight; ++y) {
+        for (int x=0; x<_maskWidth; ++x) {
+            int i = getMaskIndex(_maskLeft + x, _maskTop + y);
+            if (_mask[i] == MASK_EDGE) {
+                starts.push_back(QPointF(_maskLeft + x, _maskTop + y));
+                continue;
+            }
+            if (_mask[i] != MASK_SOLID) continue;
+
+            starts.push_back(QPointF(_maskLeft + x, _maskTop + y));
+            _mask[i] |= MASK_LABELED;
+            stack.push_back(i);
+            while (!stack.empty()) {
+                int j = stack.back();
+                stack.pop_back();
+                // padding is never solid, so neighbours need no bounds check
+                for (int k: {j - _maskStride - 1, j - _maskStride, j - _maskStride + 1, j - 1,
+                             j + 1, j + _maskStride - 1, j + _maskStride, j + _maskStride + 1}) {
+                    if (_mask[k] == MASK_SOLID) {
+                        _mask[k] |= MASK_LABELED;
+                        stack.push_back(k);
+                    }
+                }
             }
         }
     }
-    return qMakePair(false, i);
-}
-
-unsigned char PolygonImage::getAlphaByIndex(const unsigned int& i) {
-    return getAlphaByPos(getPosFromIndex(i));
-}
 
-unsigned char PolygonImage::getAlphaByPos(const QPointF& pos) {
-    return qAlpha(_image.pixel(QPoint(pos.x(), pos.y())));
+    return starts;
 }
 
-unsigned int PolygonImage::getSquareValue(const unsigned int& x, const unsigned int& y, const QRectF& rect, const float& threshold)
+unsigned int PolygonImage::getSquareValue(const int& x, const int& y)
 {
     /*
      checking the 2x2 pixel grid, assigning these values to each pixel, if not transparent
@@ -175,23 +216,15 @@ unsigned int PolygonImage::getSquareValue(const unsigned int& x, const unsigned
      | 4 | 8 | <- current pixel (curx,cury)
      +---+---+
      */
-    unsigned int sv = 0;
-    //NOTE: due to the way we pick points from texture, rect needs to be smaller, otherwise it goes outside 1 pixel
-    auto fixedRect = QRectF(rect.topLeft(), rect.size()-QSize(2,2));
-
-    QPointF tl = QPointF(x-1, y-1);
-    sv += (fixedRect.contains(tl) && getAlphaByPos(tl) > threshold)? 1 : 0;
-    QPointF tr = QPointF(x, y-1);
-    sv += (fixedRect.contains(tr) && getAlphaByPos(tr) > threshold)? 2 : 0;
-    QPointF bl = QPointF(x-1, y);
-    sv += (fixedRect.contains(bl) && getAlphaByPos(bl) > threshold)? 4 : 0;
-    QPointF br = QPointF(x, y);
-    sv += (fixedRect.contains(br) && getAlphaByPos(br) > threshold)? 8 : 0;
+    const unsigned char* mask = &_mask[getMaskIndex(x, y)];
+    unsigned int sv = (mask[-_maskStride - 1] & MASK_SOLID)
+                    | (mask[-_maskStride] & MASK_SOLID) << 1
+                    | (mask[-1] & MASK_SOLID) << 2
+                    | (mask[0] & MASK_SOLID) << 3;
 //    Q_ASSERT_X(sv != 0 && sv != 15, "square value should not be 0, or 15", "");
     return sv;
 }
-
-std::vector<QPointF> PolygonImage::marchSquare(const QRectF& rect, const QPointF& start, const float& threshold)
+std::vector<QPointF> PolygonImage::marchSquare(const QRectF& rect, const QPointF& start)
 {
     int stepx = 0;
     int stepy = 0;
@@ -204,13 +237,12 @@ std::vector<QPointF> PolygonImage::marchSquare(const QRectF& rect, const QPointF
     unsigned int count = 0;
     unsigned int totalPixel = _width*_height;
     bool problem = false;
-    std::vector<int> case9s;
-    std::vector<int> case6s;
+    // squares with case 9 or 6 flag set in _visited, cleared again when done
+    std::vector<int> visited;
     int i;
-    std::vector<int>::iterator it;
     std::vector<QPointF> _points;
     do{
-        int sv = getSquareValue(curx, cury, rect, threshold);
+        int sv = getSquareValue(curx, cury);
         switch(sv) {
             case 1:
             case 5:
@@ -278,14 +310,12 @@ std::vector<QPointF> PolygonImage::marchSquare(const QRectF& rect, const QPointF
                  this should normally go UP, but if we already been here, we go down
                 */
                 //find index from xy;
-                i = getIndexFromPos(curx, cury);
-                it = find (case9s.begin(), case9s.end(), i);
-                if (it != case9s.end())
+                i = getMaskIndex(curx, cury);
+                if (_visited[i] & VISITED_CASE9)
                 {
                     //found, so we go down, and delete from case9s;
                     stepx = 0;
                     stepy = 1;
-                    case9s.erase(it);
                     problem = true;
                 }
                 else
@@ -293,8 +323,9 @@ std::vector<QPointF> PolygonImage::marchSquare(const QRectF& rect, const QPointF
                     //not found, we go up, and add to case9s;
                     stepx = 0;
                     stepy = -1;
-                    case9s.push_back(i);
+                    visited.push_back(i);
                 }
+                _visited[i] ^= VISITED_CASE9;
                 break;
             case 6 :
                 /*
@@ -306,25 +337,25 @@ std::vector<QPointF> PolygonImage::marchSquare(const QRectF& rect, const QPointF
                  +---+---+
                  this normally go RIGHT, but if its coming from UP, it should go LEFT
                  */
-                i = getIndexFromPos(curx, cury);
-                it = find (case6s.begin(), case6s.end(), i);
-                if (it != case6s.end())
+                i = getMaskIndex(curx, cury);
+                if (_visited[i] & VISITED_CASE6)
                 {
                     //found, so we go down, and delete from case9s;
                     stepx = -1;
                     stepy = 0;
-                    case6s.erase(it);
                     problem = true;
                 }
                 else{
                     //not found, we go up, and add to case9s;
                     stepx = 1;
                     stepy = 0;
-                    case6s.push_back(i);
+                    visited.push_back(i);
                 }
+                _visited[i] ^= VISITED_CASE6;
                 break;
             default:
                 qDebug() << "this shouldn't happen:" << _points.size();
+                for (auto index: visited) _visited[index] = 0;
                 return _points;
         }
         //little optimization
@@ -350,6 +381,7 @@ std::vector<QPointF> PolygonImage::marchSquare(const QRectF& rect, const QPointF
         problem = false;
         Q_ASSERT_X(count <= totalPixel, "oh no, marching square cannot find starting position", "");
     } while(curx != startx || cury != starty);
+    for (auto index: visited) _visited[index] = 0;
     return _points;
 }
 
@@ -567,8 +599,8 @@ Triangles PolygonImage::triangulate(const std::vector<QPointF>& points) {
     std::vector<p2t::Triangle*> tris = cdt.GetTriangles();
 
     Triangles triangles;
-    unsigned short idx = 0;
-    unsigned short vdx = 0;
+    quint32 idx = 0;
+    quint32 vdx = 0;
 
     for(std::vector<p2t::Triangle*>::const_iterator ite = tris.begin(); ite < tris.end(); ite++) {
         for(int i = 0; i < 3; i++) {
@@ -4,22 +4,20 @@
 #include <QtCore>
 #include <QtGui>
 
+// implicitly shared through QVector, copying a Triangles doesn't copy vertex data
 struct Triangles {
     /**Vertex data pointer.*/
     QVector<QPoint> verts;
     /**Index data pointer.*/
-    QVector<unsigned short> indices;
-
-    std::vector<QPointF> debugPoints;
-    std::vector<int> debugPartInfo;
+    QVector<quint32> indices;
 
     void add(const Triangles& other) {
-        unsigned short idx = verts.size();
+        quint32 idx = verts.size();
         verts += other.verts;
+        indices.reserve(indices.size() + other.indices.size());
         for (int i=0; i<other.indices.size(); ++i) {
             indices.push_back(other.indices[i] + idx);
         }
-        debugPartInfo.push_back(other.indices.size() / 3);
     }
 };
 
@@ -34,16 +32,13 @@ public:
     const Polygons& polygons() const { return _polygons; }
 
 protected:
-    std::vector<QPointF> trace(const QRectF& rect, const float& threshold);
-    QPair<bool, QPointF> findFirstNoneTransparentPixel(const QRectF& rect, const float& threshold);
+    void buildMask(const QImage& image, const QRectF& rect, const float& threshold);
+    std::vector<QPointF> findIslands();
 
-    unsigned char getAlphaByIndex(const unsigned int& i);
-    unsigned char getAlphaByPos(const QPointF& pos);
-    int getIndexFromPos(const unsigned int& x, const unsigned int& y) { return y*_width+x; }
-    QPointF getPosFromIndex(const unsigned int& i) { return QPointF(i % _width, i / _width); }
+    int getMaskIndex(const int& x, const int& y) const { return (y - _maskTop + 1) * _maskStride + (x - _maskLeft + 1); }
 
-    unsigned int getSquareValue(const unsigned int& x, const unsigned int& y, const QRectF& rect, const float& threshold);
-    std::vector<QPointF> marchSquare(const QRectF& rect, const QPointF& start, const float& threshold);
+    unsigned int getSquareValue(const int& x, const int& y);
+    std::vector<QPointF> marchSquare(const QRectF& rect, const QPointF& start);
     float perpendicularDistance(const QPointF& i, const QPointF& start, const QPointF& end);
     std::vector<QPointF> rdp(std::vector<QPointF> v, const float& optimization);
     std::vector<QPointF> reduce(const std::vector<QPointF>& points, const QRectF& rect, const float& epsilon);
@@ -53,7 +48,18 @@ protected:
     Triangles triangulate(const std::vector<QPointF>& points);
 
 private:
-    QImage        _image;
+    enum { MASK_SOLID = 1, MASK_LABELED = 2, MASK_EDGE = 4 };
+    enum { VISITED_CASE9 = 1, VISITED_CASE6 = 2 };
+
+    // alpha > threshold of the rect pixels, padded by one transparent pixel on each side
+    std::vector<unsigned char> _mask;
+    std::vector<unsigned char> _visited;
+    int           _maskLeft;
+    int           _maskTop;
+    int           _maskWidth;
+    int           _maskHeight;
+    int           _maskStride;
+
     unsigned int  _width;
     unsigned int  _height;
     unsigned int  _threshold;
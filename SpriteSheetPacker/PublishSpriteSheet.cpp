@@ -4,10 +4,20 @@
 #include "PListSerializer.h"
 #include <QMessageBox>
 #include "PngOptimizer.h"
+#include "PngEncoder.h"
 #include "PVRTexture.h"
 #include "PVRTextureUtilities.h"
 
 /////////////////////////////////////////////////////////////////////////////////////////////
+bool writeFile(const QString& fileName, const QByteArray& data, QString& errorString) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || (file.write(data) != data.size())) {
+        errorString = QString("Save image error %1: %2").arg(fileName, file.errorString());
+        return false;
+    }
+    return true;
+}
+
 unsigned int checksumPvr(const unsigned int *data, unsigned int len) {
     unsigned int cs = 0;
     const int cslen = 128;
@@ -151,11 +161,22 @@ PublishSpriteSheet::PublishSpriteSheet() {
     _imageFormat = kPNG;
     _pixelFormat = kARGB8888;
     _premultiplied = true;
+    _pngQuality.minQuality = 0;
+    _pngQuality.maxQuality = 100;
+    _pngEncodePreset = "Balanced";
     _webpQuality = 80;
     _jpgQuality = 80;
 
     _trimSpriteNames = true;
     _prependSmartFolderName = true;
+
+    _pool.setMaxThreadCount(QThread::idealThreadCount());
+    _running = false;
+    _reporting = false;
+    _finishedTasks = 0;
+    _errorMessage = true;
+
+    connect(&_taskWatcher, &QFutureWatcher<QString>::finished, this, &PublishSpriteSheet::onTaskFinished);
 }
 
 void PublishSpriteSheet::addSpriteSheet(const SpriteAtlas &atlas, const QString &fileName) {
@@ -165,14 +186,26 @@ void PublishSpriteSheet::addSpriteSheet(const SpriteAtlas &atlas, const QString
 
 bool PublishSpriteSheet::publish(const QString& format, bool errorMessage) {
 
-    if (_spriteAtlases.size() != _fileNames.size()) {
+    if ((_spriteAtlases.size() != _fileNames.size()) || _running) {
         return false;
     }
 
-    QStringList outputFilePaths;
+    _running = true;
+    _finishedTasks = 0;
+    _firstError.clear();
+    _errorMessage = errorMessage;
+
+    // every page of every variant writes its own files, so the data file and the image of each
+    // page are independent tasks. They run on a bounded pool and are collected in submission
+    // order, so the progress log and the reported errors don't depend on thread timing.
+    // lossy pages of a sheet share one palette, so they are quantized together in one task
+    const bool quantizeSheets = (_imageFormat == kPNG) && (_pngQuality.optMode == "Lossy");
+
     for (int i = 0; i < _spriteAtlases.size(); i++) {
         const SpriteAtlas& atlas = _spriteAtlases.at(i);
         const QString& filePath = _fileNames.at(i);
+        QStringList sheetFilePaths;
+        QVector<QImage> sheetImages;
 
         for (int n=0; n<atlas.outputData().size(); ++n) {
             const auto& outputData = atlas.outputData().at(n);
@@ -186,162 +219,282 @@ bool PublishSpriteSheet::publish(const QString& format, bool errorMessage) {
                 outputFilePath = outputFilePath + "_" + QString::number(n);
             }
 
-            // save this name for optimize png
-            outputFilePaths.push_back(outputFilePath);
-
             // generate the data file and the image
-            if (!format.isEmpty() && !generateDataFile(outputFilePath, format, outputData._spriteFrames, outputData._atlasImage, errorMessage)) {
+            if (!format.isEmpty()) {
+                _taskNames.push_back(QString("Data file: %1").arg(outputFilePath));
+                int pageCount = atlas.outputData().size();
+                _futures.push_back(QtConcurrent::run(&_pool, [this, outputFilePath, format, outputData, n, pageCount]() {
+                    QString errorString;
+                    generateDataFile(outputFilePath, format, outputData, n, pageCount, errorString);
+                    return errorString;
+                }));
+            }
+
+            if (quantizeSheets) {
+                sheetFilePaths.push_back(outputFilePath);
+                sheetImages.push_back(outputData._atlasImage);
+                continue;
+            }
+
+            _taskNames.push_back(QString("Image: %1").arg(outputFilePath + imagePrefix(_imageFormat)));
+            _futures.push_back(QtConcurrent::run(&_pool, [this, outputFilePath, outputData]() {
+                QString errorString;
+                saveImage(outputFilePath, outputData._atlasImage, errorString);
+                return errorString;
+            }));
+        }
+
+        if (!sheetImages.isEmpty()) {
+            _taskNames.push_back(QString("Images: %1").arg(filePath + imagePrefix(_imageFormat)));
+            _futures.push_back(QtConcurrent::run(&_pool, [this, sheetFilePaths, sheetImages]() {
+                QString errorString;
+                saveQuantizedImages(sheetFilePaths, sheetImages, errorString);
+                return errorString;
+            }));
+        }
+    }
+
+    // return to the event loop, the tasks are reported as they finish
+    QTimer::singleShot(0, this, &PublishSpriteSheet::onTaskFinished);
+    return true;
+}
+
+bool PublishSpriteSheet::waitForFinished() {
+    while (_running) {
+        if (_finishedTasks < _futures.size()) {
+            _futures[_finishedTasks].waitForFinished();
+        }
+        onTaskFinished();
+    }
+    return _firstError.isEmpty();
+}
+
+void PublishSpriteSheet::onTaskFinished() {
+    // the progress listener may process events, the outer call reports the tasks finished meanwhile
+    if (!_running || _reporting) return;
+    _reporting = true;
+
+    // a task finished out of order is reported when the ones before it are done
+    while ((_finishedTasks < _futures.size()) && _futures[_finishedTasks].isFinished()) {
+        QString errorString = _futures[_finishedTasks].result();
+        if (!errorString.isEmpty()) {
+            qDebug() << errorString;
+            if (_firstError.isEmpty()) _firstError = errorString;
+        }
+        ++_finishedTasks;
+        emit publishProgress(_finishedTasks, _futures.size(), _taskNames.at(_finishedTasks - 1));
+    }
+    _reporting = false;
+
+    if (_finishedTasks < _futures.size()) {
+        _taskWatcher.setFuture(_futures[_finishedTasks]);
+        return;
+    }
+
+    _running = false;
+    _futures.clear();
+    _taskNames.clear();
+    _spriteAtlases.clear();
+    _fileNames.clear();
+
+    bool result = _firstError.isEmpty();
+    if (!result && _errorMessage) {
+        QMessageBox::critical(NULL, "Publish error", _firstError);
+    }
+    if (result && (_imageFormat == kPNG) && (_pngQuality.optMode != "None")) {
+        // the publish tasks already optimized the images in memory
+        emit onCompletedOptimizePNG();
+    }
+    emit publishFinished(result);
+}
+
+bool PublishSpriteSheet::saveImage(const QString& outputFilePath, const QImage& atlasImage, QString& errorString) {
+    QString fileName = outputFilePath + imagePrefix(_imageFormat);
+    qDebug() << "Save image:" << fileName;
+    if ((_imageFormat == kPNG) || (_imageFormat == kWEBP) || (_imageFormat == kJPG) || (_imageFormat == kJPG_PNG)) {
+        QImage image = convertImage(atlasImage, _pixelFormat, _premultiplied);
+        if ((_imageFormat == kPNG) && (_pngQuality.optMode != "None")) {
+            // encode and optimize in memory, the file is written once
+            QByteArray png;
+            if (!optimizePNG(image, png)) {
+                errorString = QString("Optimize image error %1").arg(fileName);
+                return false;
+            }
+            if (!writeFile(fileName, png, errorString)) {
+                return false;
+            }
+        } else if (_imageFormat == kPNG) {
+            QByteArray png;
+            if (!encodePng(image, PngEncodeSettings::fromPreset(_pngEncodePreset), png)) {
+                errorString = QString("Encode image error %1").arg(fileName);
+                return false;
+            }
+            if (!writeFile(fileName, png, errorString)) {
+                return false;
+            }
+        } else if (_imageFormat == kWEBP) {
+            QImageWriter writer(outputFilePath + imagePrefix(kWEBP), "webp");
+            writer.setOptimizedWrite(true);
+            writer.setCompression(100);
+            writer.setQuality(_webpQuality);
+            if (!writer.write(image)) {
+                errorString = QString("Save image error %1: %2").arg(writer.fileName(), writer.errorString());
+                return false;
+            }
+        } else if ((_imageFormat == kJPG) || (_imageFormat == kJPG_PNG)) {
+            QImageWriter writer(outputFilePath + imagePrefix(kJPG), "jpg");
+            writer.setOptimizedWrite(true);
+            writer.setCompression(100);
+            writer.setQuality(_jpgQuality);
+            if (!writer.write(image)) {
+                errorString = QString("Save image error %1: %2").arg(writer.fileName(), writer.errorString());
                 return false;
             }
 
-            // save image
-            QString fileName = outputFilePath + imagePrefix(_imageFormat);
-            qDebug() << "Save image:" << fileName;
-            if ((_imageFormat == kPNG) || (_imageFormat == kWEBP) || (_imageFormat == kJPG) || (_imageFormat == kJPG_PNG)) {
-                QImage image = convertImage(outputData._atlasImage, _pixelFormat, _premultiplied);
-                if (_imageFormat == kPNG) {
-                    QImageWriter writer(outputFilePath + imagePrefix(kPNG), "png");
-                    writer.setOptimizedWrite(true);
-                    writer.setCompression(100);
-                    writer.setQuality(0);
-                    writer.write(image);
-                } else if (_imageFormat == kWEBP) {
-                    QImageWriter writer(outputFilePath + imagePrefix(kWEBP), "webp");
-                    writer.setOptimizedWrite(true);
-                    writer.setCompression(100);
-                    writer.setQuality(_webpQuality);
-                    writer.write(image);
-                } else if ((_imageFormat == kJPG) || (_imageFormat == kJPG_PNG)) {
-                    QImageWriter writer(outputFilePath + imagePrefix(kJPG), "jpg");
-                    writer.setOptimizedWrite(true);
-                    writer.setCompression(100);
-                    writer.setQuality(_jpgQuality);
-                    writer.write(image);
-
-                    if (_imageFormat == kJPG_PNG) {
-                        QImage maskImage = convertImage(outputData._atlasImage, kALPHA, _premultiplied);
-                        QImageWriter writer(outputFilePath + imagePrefix(kPNG), "png");
-                        writer.setOptimizedWrite(true);
-                        writer.setCompression(100);
-                        writer.setQuality(0);
-                        writer.write(maskImage);
-                    }
+            if (_imageFormat == kJPG_PNG) {
+                QImage maskImage = convertImage(atlasImage, kALPHA, _premultiplied);
+                QByteArray png;
+                if (!encodePng(maskImage, PngEncodeSettings::fromPreset(_pngEncodePreset), png)) {
+                    errorString = QString("Encode image error %1").arg(outputFilePath + imagePrefix(kPNG));
+                    return false;
                 }
-            } else if ((_imageFormat == kPKM) || (_imageFormat == kPVR) || (_imageFormat == kPVR_CCZ)) {
-                CPVRTextureHeader pvrHeader(PVRStandard8PixelType.PixelTypeID,
-                                            outputData._atlasImage.height(),
-                                            outputData._atlasImage.width());
-                // create the texture
-                CPVRTexture pvrTexture(pvrHeader, outputData._atlasImage.bits());
-                switch (_pixelFormat) {
-                    case kETC1: Transcode(pvrTexture, PixelType(ePVRTPF_ETC1), ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacelRGB, eETCFast, true); break;
-                    case kETC2: Transcode(pvrTexture, PixelType(ePVRTPF_ETC2_RGB), ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacelRGB, eETCFast, true); break;
-                    case kETC2A: Transcode(pvrTexture, PixelType(ePVRTPF_ETC2_RGBA), ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacelRGB, eETCFast, true); break;
-                    case kPVRTC2: Transcode(pvrTexture, PixelType(ePVRTPF_PVRTCI_2bpp_RGB), ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacelRGB, ePVRTCBest, true); break;
-                    case kPVRTC2A: Transcode(pvrTexture, PixelType(ePVRTPF_PVRTCI_2bpp_RGBA), ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacelRGB, ePVRTCBest, true); break;
-                    case kPVRTC4: Transcode(pvrTexture, PixelType(ePVRTPF_PVRTCI_4bpp_RGB), ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacelRGB, ePVRTCBest, true); break;
-                    case kPVRTC4A: Transcode(pvrTexture, PixelType(ePVRTPF_PVRTCI_4bpp_RGBA), ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacelRGB, ePVRTCBest, true); break;
-                    case kDXT1: Transcode(pvrTexture, PixelType(ePVRTPF_DXT1), ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacelRGB, ePVRTCBest, true); break;
-                    case kDXT3: Transcode(pvrTexture, PixelType(ePVRTPF_DXT3), ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacelRGB, ePVRTCBest, true); break;
-                    case kDXT5: Transcode(pvrTexture, PixelType(ePVRTPF_DXT5), ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacelRGB, ePVRTCBest, true); break;
-                    default: break;
+                if (!writeFile(outputFilePath + imagePrefix(kPNG), png, errorString)) {
+                    return false;
                 }
+            }
+        }
+    } else if ((_imageFormat == kPKM) || (_imageFormat == kPVR) || (_imageFormat == kPVR_CCZ)) {
+        CPVRTextureHeader pvrHeader(PVRStandard8PixelType.PixelTypeID,
+                                    atlasImage.height(),
+                                    atlasImage.width());
+        // create the texture
+        CPVRTexture pvrTexture(pvrHeader, atlasImage.bits());
+        switch (_pixelFormat) {
+            case kETC1: Transcode(pvrTexture, PixelType(ePVRTPF_ETC1), ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacelRGB, eETCFast, true); break;
+            case kETC2: Transcode(pvrTexture, PixelType(ePVRTPF_ETC2_RGB), ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacelRGB, eETCFast, true); break;
+            case kETC2A: Transcode(pvrTexture, PixelType(ePVRTPF_ETC2_RGBA), ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacelRGB, eETCFast, true); break;
+            case kPVRTC2: Transcode(pvrTexture, PixelType(ePVRTPF_PVRTCI_2bpp_RGB), ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacelRGB, ePVRTCBest, true); break;
+            case kPVRTC2A: Transcode(pvrTexture, PixelType(ePVRTPF_PVRTCI_2bpp_RGBA), ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacelRGB, ePVRTCBest, true); break;
+            case kPVRTC4: Transcode(pvrTexture, PixelType(ePVRTPF_PVRTCI_4bpp_RGB), ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacelRGB, ePVRTCBest, true); break;
+            case kPVRTC4A: Transcode(pvrTexture, PixelType(ePVRTPF_PVRTCI_4bpp_RGBA), ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacelRGB, ePVRTCBest, true); break;
+            case kDXT1: Transcode(pvrTexture, PixelType(ePVRTPF_DXT1), ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacelRGB, ePVRTCBest, true); break;
+            case kDXT3: Transcode(pvrTexture, PixelType(ePVRTPF_DXT3), ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacelRGB, ePVRTCBest, true); break;
+            case kDXT5: Transcode(pvrTexture, PixelType(ePVRTPF_DXT5), ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacelRGB, ePVRTCBest, true); break;
+            default: break;
+        }
 
-                qDebug() << "Transcode complete.";
-                // save the file
-                if (_imageFormat == kPVR_CCZ) {
-                    QString tempFileName = outputFilePath + "_temp.pvr";
-                    pvrTexture.saveFile(tempFileName.toStdString().c_str());
-
-                    // read and compress
-                    QFile file(tempFileName);
-                    file.open(QIODevice::ReadOnly);
-                    unsigned int uncompressedLen = file.size();
-                    QByteArray compressedData = qCompress(file.readAll());
-                    file.close();
-                    QFile::remove(tempFileName);
-
-                    //  Strip the first six bytes (a 4-byte length put on by qCompress)
-                    compressedData.remove(0, 4);
-
-                    struct CCZHeader {
-                        unsigned char   sig[4];             /** Signature. Should be 'CCZ!' 4 bytes. */
-                        unsigned short  compression_type;   /** Should be 0. */
-                        unsigned short  version;            /** Should be 2 (although version type==1 is also supported). */
-                        unsigned int    reserved;           /** Reserved for users. */
-                        unsigned int    len;                /** Size of the uncompressed file. */
-                    };
-
-                    CCZHeader cczHeader;
-                    cczHeader.sig[0] = 'C';
-                    cczHeader.sig[1] = 'C';
-                    cczHeader.sig[2] = 'Z';
-                    cczHeader.sig[3] = _encryptionKey.isEmpty()? '!':'p';
-                    cczHeader.compression_type = qToBigEndian<unsigned short>(0);
-                    cczHeader.version = qToBigEndian<unsigned short>(0);
-                    cczHeader.reserved = qToBigEndian<unsigned int>(0);
-                    cczHeader.len = qToBigEndian<unsigned int>(uncompressedLen);
-
-                    compressedData.insert(0, QByteArray((const char *)&cczHeader, sizeof(CCZHeader)));
-
-                    // encrypt
-                    if (!_encryptionKey.isEmpty()) {
-                        QString key = _encryptionKey;
-                        uint32_t keys[4];
-                        keys[0] = key.left(8).toUInt(nullptr, 16); key.remove(0, 8);
-                        keys[1] = key.left(8).toUInt(nullptr, 16); key.remove(0, 8);
-                        keys[2] = key.left(8).toUInt(nullptr, 16); key.remove(0, 8);
-                        keys[3] = key.left(8).toUInt(nullptr, 16); key.remove(0, 8);
-
-                        unsigned int* ints = (unsigned int*)(compressedData.data()+12);
-                        unsigned int enclen = (compressedData.length()-12)/4;
-
-                        CCZHeader* header = (CCZHeader*)compressedData.data();
-                        header->reserved = qToBigEndian<unsigned int>(checksumPvr(ints, enclen));
-
-                        encodePvr(ints, enclen, keys);
-                    }
-
-                    // write compressed data
-                    file.setFileName(fileName);
-                    file.open(QIODevice::WriteOnly);
-                    file.write(compressedData);
-                    file.close();
-                } else {
-                    pvrTexture.saveFile(fileName.toStdString().c_str());
-                }
-                qDebug() << "Write to file complete.";
+        qDebug() << "Transcode complete.";
+        // save the file
+        if (_imageFormat == kPVR_CCZ) {
+            QString tempFileName = outputFilePath + "_temp.pvr";
+            pvrTexture.saveFile(tempFileName.toStdString().c_str());
+
+            // read and compress
+            QFile file(tempFileName);
+            file.open(QIODevice::ReadOnly);
+            unsigned int uncompressedLen = file.size();
+            QByteArray compressedData = qCompress(file.readAll());
+            file.close();
+            QFile::remove(tempFileName);
+
+            //  Strip the first six bytes (a 4-byte length put on by qCompress)
+            compressedData.remove(0, 4);
+
+            struct CCZHeader {
+                unsigned char   sig[4];             /** Signature. Should be 'CCZ!' 4 bytes. */
+                unsigned short  compression_type;   /** Should be 0. */
+                unsigned short  version;            /** Should be 2 (although version type==1 is also supported). */
+                unsigned int    reserved;           /** Reserved for users. */
+                unsigned int    len;                /** Size of the uncompressed file. */
+            };
+
+            CCZHeader cczHeader;
+            cczHeader.sig[0] = 'C';
+            cczHeader.sig[1] = 'C';
+            cczHeader.sig[2] = 'Z';
+            cczHeader.sig[3] = _encryptionKey.isEmpty()? '!':'p';
+            cczHeader.compression_type = qToBigEndian<unsigned short>(0);
+            cczHeader.version = qToBigEndian<unsigned short>(0);
+            cczHeader.reserved = qToBigEndian<unsigned int>(0);
+            cczHeader.len = qToBigEndian<unsigned int>(uncompressedLen);
+
+            compressedData.insert(0, QByteArray((const char *)&cczHeader, sizeof(CCZHeader)));
+
+            // encrypt
+            if (!_encryptionKey.isEmpty()) {
+                QString key = _encryptionKey;
+                uint32_t keys[4];
+                keys[0] = key.left(8).toUInt(nullptr, 16); key.remove(0, 8);
+                keys[1] = key.left(8).toUInt(nullptr, 16); key.remove(0, 8);
+                keys[2] = key.left(8).toUInt(nullptr, 16); key.remove(0, 8);
+                keys[3] = key.left(8).toUInt(nullptr, 16); key.remove(0, 8);
+
+                unsigned int* ints = (unsigned int*)(compressedData.data()+12);
+                unsigned int enclen = (compressedData.length()-12)/4;
+
+                CCZHeader* header = (CCZHeader*)compressedData.data();
+                header->reserved = qToBigEndian<unsigned int>(checksumPvr(ints, enclen));
+
+                encodePvr(ints, enclen, keys);
+            }
+
+            // write compressed data
+            file.setFileName(fileName);
+            if (!file.open(QIODevice::WriteOnly)) {
+                errorString = QString("Save image error %1: %2").arg(fileName, file.errorString());
+                return false;
             }
+            file.write(compressedData);
+            file.close();
+        } else if (!pvrTexture.saveFile(fileName.toStdString().c_str())) {
+            errorString = QString("Save image error %1").arg(fileName);
+            return false;
         }
+        qDebug() << "Write to file complete.";
+    }
+
+    return true;
+}
+
+bool PublishSpriteSheet::saveQuantizedImages(const QStringList& outputFilePaths, const QVector<QImage>& atlasImages, QString& errorString) {
+    QVector<QImage> images;
+    for (const QImage& atlasImage: atlasImages) {
+        images.push_back(convertImage(atlasImage, _pixelFormat, _premultiplied));
     }
 
-    if ((_imageFormat == kPNG) && (_pngQuality.optMode != "None")) {
-        qDebug() << "Begin optimize image...";
-        // we use values 1-7 so that it is more user friendly, because 0 also means optimization.
-        optimizePNGInThread(outputFilePaths, _pngQuality.optMode, _pngQuality.optLevel - 1);
+    // we use values 1-7 so that it is more user friendly, because 0 also means optimization.
+    PngQuantOptimizer optimizer(_pngQuality.optLevel - 1);
+    optimizer.setQuality(_pngQuality.minQuality, _pngQuality.maxQuality);
+    QVector<QByteArray> pngs;
+    if (!optimizer.optimizeImages(images, pngs)) {
+        errorString = QString("Optimize image error %1").arg(outputFilePaths.join(", "));
+        return false;
     }
 
-    _spriteAtlases.clear();
-    _fileNames.clear();
+    for (int i = 0; i < outputFilePaths.size(); ++i) {
+        QString fileName = outputFilePaths.at(i) + imagePrefix(kPNG);
+        qDebug() << "Save image:" << fileName;
+        if (!writeFile(fileName, pngs.at(i), errorString)) {
+            return false;
+        }
+    }
 
     return true;
 }
 
-bool PublishSpriteSheet::generateDataFile(const QString& filePath, const QString& format,  const QMap<QString, SpriteFrameInfo>& spriteFrames, const QImage& atlasImage, bool errorMessage) {
+bool PublishSpriteSheet::generateDataFile(const QString& filePath, const QString& format, const SpriteAtlas::OutputData& outputData, int page, int pageCount, QString& errorString) {
     QJSEngine engine;
 
     auto it_format = _formats.find(format);
     if (it_format == _formats.end()) {
-        QString errorString = QString("Not found script file for [%1] format").arg(format);
-        qDebug() << errorString;
-        if (errorMessage) QMessageBox::critical(NULL, "Export script error", errorString);
+        errorString = QString("Not found script file for [%1] format").arg(format);
         return false;
     }
 
     QString scriptFileName = it_format.value();
     QFile scriptFile(scriptFileName);
     if (!scriptFile.open(QIODevice::ReadOnly)) {
-        qDebug() << "File [" << scriptFileName << "] not found!";
+        errorString = QString("File [%1] not found!").arg(scriptFileName);
         return false;
     }
 
@@ -358,9 +511,7 @@ bool PublishSpriteSheet::generateDataFile(const QString& filePath, const QString
     qDebug() << "Run script...";
     QJSValue result = engine.evaluate(contents);
     if (result.isError()) {
-        QString errorString = "Uncaught exception at line " + result.property("lineNumber").toString() + " : " + result.toString();
-        qDebug() << errorString;
-        if (errorMessage) QMessageBox::critical(NULL, "Export script error", errorString);
+        errorString = "Uncaught exception at line " + result.property("lineNumber").toString() + " : " + result.toString();
         return false;
     }
 
@@ -377,6 +528,7 @@ bool PublishSpriteSheet::generateDataFile(const QString& filePath, const QString
         }
 
         // collect sprite frames
+        const QMap<QString, SpriteFrameInfo>& spriteFrames = outputData._spriteFrames;
         QJSValue spriteFramesValue = engine.newObject();
         auto it_f = spriteFrames.cbegin();
         for (; it_f != spriteFrames.cend(); ++it_f) {
@@ -403,29 +555,35 @@ bool PublishSpriteSheet::generateDataFile(const QString& filePath, const QString
         }
         args << QJSValue(spriteFramesValue);
 
-        args << jsValue(engine, atlasImage.size());
+        args << jsValue(engine, outputData._atlasImage.size());
+
+        // page of a multi page sprite sheet and how well the sprites fill it
+        QJSValue pageValue = engine.newObject();
+        pageValue.setProperty("index", page);
+        pageValue.setProperty("count", pageCount);
+        pageValue.setProperty("fillRatio", outputData._fillRatio);
+        args << pageValue;
 
         // run export
         QJSValue exportSpriteSheet = engine.globalObject().property("exportSpriteSheet");
         result = exportSpriteSheet.call(args);
 
         if (result.isError()) {
-            QString errorString = "Uncaught exception at line " + result.property("lineNumber").toString() + " : " + result.toString();
-            qDebug() << errorString;
-            if (errorMessage) QMessageBox::critical(NULL, "Export script error", errorString);
+            errorString = "Uncaught exception at line " + result.property("lineNumber").toString() + " : " + result.toString();
             return false;
         } else {
             // write data
             if (!result.hasProperty("data") || !result.hasProperty("format")) {
-                QString errorString = "Script function must be return object: {data:data, format:'plist|json|other'}";
-                qDebug() << errorString;
-                if (errorMessage) QMessageBox::critical(NULL, "Export script error", errorString);
+                errorString = "Script function must be return object: {data:data, format:'plist|json|other'}";
                 return false;
             } else {
                 QJSValue data = result.property("data");
                 QString format = result.property("format").toString();
                 QFile file(filePath + "." + format);
-                file.open(QIODevice::WriteOnly | QIODevice::Text);
+                if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+                    errorString = QString("Write data file error %1: %2").arg(file.fileName(), file.errorString());
+                    return false;
+                }
                 QTextStream out(&file);
                 if (format == "plist") {
                     out << PListSerializer::toPList(data.toVariant());
@@ -436,42 +594,25 @@ bool PublishSpriteSheet::generateDataFile(const QString& filePath, const QString
         }
 
     } else {
-        qDebug() << "Not found global exportSpriteSheet function!";
-        if (errorMessage) QMessageBox::critical(NULL, "Export script error", "Not found global exportSpriteSheet function!");
+        errorString = "Not found global exportSpriteSheet function!";
         return false;
     }
 
     return true;
 }
 
-bool PublishSpriteSheet::optimizePNG(const QString& fileName, const QString& optMode, int optLevel) {
-    bool result = false;
+bool PublishSpriteSheet::optimizePNG(const QImage& image, QByteArray& png) const {
+    // we use values 1-7 so that it is more user friendly, because 0 also means optimization.
+    int optLevel = _pngQuality.optLevel - 1;
 
-    if (optMode == "Lossless") {
+    if (_pngQuality.optMode == "Lossless") {
         OptiPngOptimizer optimizer(optLevel);
-
-        _mutex.lock();
-        result = optimizer.optimizeFile(fileName + ".png");
-        _mutex.unlock();
-    } else if (optMode == "Lossy") {
+        return optimizer.optimizeImage(image, png);
+    } else if (_pngQuality.optMode == "Lossy") {
         PngQuantOptimizer optimizer(optLevel);
-
-        _mutex.lock();
-        result = optimizer.optimizeFile(fileName + ".png");
-        _mutex.unlock();
-    }
-
-    return result;
-}
-
-void PublishSpriteSheet::optimizePNGInThread(QStringList fileNames, const QString& optMode, int optLevel) {
-    QObject::connect(&_watcher, SIGNAL(finished()), this, SIGNAL(onCompletedOptimizePNG()));
-
-    QFuture<bool> resultFuture;
-
-    for (const QString& fileName : fileNames) {
-        resultFuture = QtConcurrent::run(this, &PublishSpriteSheet::optimizePNG, fileName, optMode, optLevel);
+        optimizer.setQuality(_pngQuality.minQuality, _pngQuality.maxQuality);
+        return optimizer.optimizeImage(image, png);
     }
 
-    _watcher.setFuture(resultFuture);
+    return false;
 }
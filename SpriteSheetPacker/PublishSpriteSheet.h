@@ -31,29 +31,38 @@ public:
     void setPixelFormat(PixelFormat pixelFormat) { _pixelFormat = pixelFormat; }
     void setPremultiplied(bool premultiplied) { _premultiplied = premultiplied; }
     void setPngQuality(const QString& optMode, int optLevel) { _pngQuality.optMode = optMode; _pngQuality.optLevel = optLevel; }
+    void setPngQuantQuality(int minimum, int maximum) { _pngQuality.minQuality = minimum; _pngQuality.maxQuality = maximum; }
+    void setPngEncodePreset(const QString& preset) { _pngEncodePreset = preset; }
     void setWebpQuality(int quality) { _webpQuality = quality; }
     void setJpgQuality(int quality) { _jpgQuality = quality; }
     void setTrimSpriteNames(bool trimSpriteNames) { _trimSpriteNames = trimSpriteNames; }
     void setPrependSmartFolderName(bool prependSmartFolderName) { _prependSmartFolderName = prependSmartFolderName; }
     void setEncryptionKey(const QString& key) { _encryptionKey = key; }
 
+    // starts the publish tasks and returns, publishFinished is emitted when all of them are done
     bool publish(const QString& format, bool errorMessage = true);
+    // reports the remaining tasks of publish() without the event loop, false on error
+    bool waitForFinished();
 
     static void addFormat(const QString& format, const QString& scriptFileName) { _formats[format] = scriptFileName; }
     static QMap<QString, QString>& formats() { return _formats; }
 
 signals:
     void onCompletedOptimizePNG();
+    // emitted after each data file or image task, in submission order
+    void publishProgress(int done, int total, const QString& task);
+    void publishFinished(bool result);
 
 protected:
-    bool generateDataFile(const QString& filePath, const QString& format, const QMap<QString, SpriteFrameInfo>& spriteFrames, const QImage& atlasImage, bool errorMessage = true);
-    bool optimizePNG(const QString& fileName, const QString& optMode, int optLevel);
-    void optimizePNGInThread(QStringList fileNames, const QString& optMode, int optLevel);
+    // both run on the publish pool, errors go to errorString instead of a message box
+    bool generateDataFile(const QString& filePath, const QString& format, const SpriteAtlas::OutputData& outputData, int page, int pageCount, QString& errorString);
+    bool saveImage(const QString& outputFilePath, const QImage& atlasImage, QString& errorString);
+    bool saveQuantizedImages(const QStringList& outputFilePaths, const QVector<QImage>& atlasImages, QString& errorString);
+    bool optimizePNG(const QImage& image, QByteArray& png) const;
 
-protected:
-    QFutureWatcher<bool> _watcher;
-    QMutex _mutex;
+    void onTaskFinished();
 
+protected:
     QList<SpriteAtlas> _spriteAtlases;
     QStringList _fileNames;
 
@@ -64,8 +73,12 @@ protected:
     struct {
         QString optMode;
         int     optLevel;
+        int     minQuality;
+        int     maxQuality;
     } _pngQuality;
 
+    QString     _pngEncodePreset;
+
     int         _webpQuality;
     int         _jpgQuality;
 
@@ -74,6 +87,17 @@ protected:
 
     QString     _encryptionKey;
 
+    // running publish, the tasks are reported in submission order
+    QThreadPool _pool;
+    bool        _running;
+    bool        _reporting;
+    QList<QFuture<QString>> _futures;
+    QStringList _taskNames;
+    int         _finishedTasks;
+    QFutureWatcher<QString> _taskWatcher;
+    QString     _firstError;
+    bool        _errorMessage;
+
     static QMap<QString, QString> _formats;
 };
 
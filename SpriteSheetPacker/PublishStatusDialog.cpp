@@ -22,6 +22,11 @@ void messageOutput(QtMsgType type, const QMessageLogContext &context, const QStr
         abort();
     }
     if(gTextEdit) {
+        // publish tasks log from pool threads, the text edit is only touched on its own thread
+        if (QThread::currentThread() != gTextEdit->thread()) {
+            QMetaObject::invokeMethod(gTextEdit, "append", Qt::QueuedConnection, Q_ARG(QString, msg));
+            return;
+        }
         switch (type) {
         case QtInfoMsg:
         case QtDebugMsg:
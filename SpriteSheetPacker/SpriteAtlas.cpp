@@ -1,11 +1,74 @@
 #include "SpriteAtlas.h"
 
 #include <functional>
+#include <numeric>
+#include <QtConcurrent>
 #include "binpack2d.hpp"
+#include "maxrects2d.hpp"
+#include "skyline2d.hpp"
 #include "polypack2d.h"
-#include "ImageRotate.h"
+#include "ImageTrim.h"
+#include "SpriteCache.h"
 #include "PolygonImage.h"
 
+struct SpriteIngest {
+    QString     filePath;
+    QString     name;
+    PackContent content;
+    bool        valid = false;
+};
+
+// packers carry indices into the sprite table, so no PackContent is copied while packing
+typedef BinPack2D::Content<int>::Vector RectContentVector;
+
+template <typename Canvas>
+bool placeOnCanvas(Canvas& canvas, const RectContentVector& input, RectContentVector& output) {
+    if (!canvas.PlaceAll(input)) return false;
+    output = canvas.GetContents();
+    return true;
+}
+
+// one pack into width x height with the rect packer selected by algorithm name,
+// gives up on the first sprite that doesn't fit
+bool placeRects(const QString& algorithm, int width, int height, const RectContentVector& input, RectContentVector& output) {
+    if (algorithm.startsWith("MaxRects")) {
+        MaxRects2D::Canvas<int> canvas(width, height, MaxRects2D::HeuristicFromString(algorithm.section('-', 1).toStdString()));
+        return placeOnCanvas(canvas, input, output);
+    } else if (algorithm == "Skyline") {
+        Skyline2D::Canvas<int> canvas(width, height);
+        return placeOnCanvas(canvas, input, output);
+    }
+    BinPack2D::Canvas<int> canvas(width, height);
+    return placeOnCanvas(canvas, input, output);
+}
+
+template <typename Canvas>
+bool placeAround(Canvas& canvas, const RectContentVector& reserved, const RectContentVector& input, RectContentVector& output) {
+    for (const auto& content: reserved) {
+        if (!canvas.Reserve(content)) return false;
+    }
+    RectContentVector remainder;
+    if (!canvas.Place(input, remainder)) {
+        qDebug() << "Free space is not enough for" << remainder.size() << "sprites";
+        return false;
+    }
+    output = canvas.GetContents();
+    return true;
+}
+
+// keeps reserved contents where they are and places input into the free space with the rect packer
+// selected by algorithm, same packer as a full pack. Skyline can't reserve space below its outline.
+bool placeRectsAround(const QString& algorithm, int width, int height, const RectContentVector& reserved, const RectContentVector& input, RectContentVector& output) {
+    if (algorithm.startsWith("MaxRects")) {
+        MaxRects2D::Canvas<int> canvas(width, height, MaxRects2D::HeuristicFromString(algorithm.section('-', 1).toStdString()));
+        return placeAround(canvas, reserved, input, output);
+    } else if (algorithm == "Skyline") {
+        return false;
+    }
+    BinPack2D::Canvas<int> canvas(width, height);
+    return placeAround(canvas, reserved, input, output);
+}
+
 int pow2(int len) {
     int order = 1;
     while(pow(2,order) < len)
@@ -15,51 +78,58 @@ int pow2(int len) {
     return pow(2,order);
 }
 
-PackContent::PackContent() {
+PackContent::PackContent()
+    : _hash(0)
+{
     // only for QVector
-    qDebug() << "PackContent::PackContent()";
 }
 PackContent::PackContent(const QString& name, const QImage& image) {
     _name = name;
     _image = image;
     _rect = QRect(0, 0, _image.width(), _image.height());
+    _hash = 0;
 }
 
-bool PackContent::isIdentical(const PackContent& other) {
+bool PackContent::isIdentical(const PackContent& other) const {
+    if (_hash != other._hash) return false;
     if (_rect != other._rect) return false;
-
-    for (int x = _rect.left(); x < _rect.right(); ++x) {
-        for (int y = _rect.top(); y < _rect.bottom(); ++y) {
-            if (_image.pixel(x, y) != other._image.pixel(x, y)) return false;
-        }
+    if (_image.size() != other._image.size()) return false;
+    if (_image.format() != other._image.format()) return false;
+
+    // trim() may return a rect bigger than a tiny image
+    const QRect rect = _rect & _image.rect();
+    const int bytesPerPixel = _image.depth() / 8;
+    const int lineSize = rect.width() * bytesPerPixel;
+    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+        const uchar* line = _image.constScanLine(y) + rect.left() * bytesPerPixel;
+        const uchar* otherLine = other._image.constScanLine(y) + rect.left() * bytesPerPixel;
+        if (memcmp(line, otherLine, lineSize) != 0) return false;
     }
 
     return true;
 }
 
-void PackContent::trim(int alpha) {
-    int l = _image.width();
-    int t = _image.height();
-    int r = 0;
-    int b = 0;
-    for (int y=0; y<_image.height(); y++) {
-        bool rowFilled = false;
-        for (int x=0; x<_image.width(); x++) {
-            int a = qAlpha(_image.pixel(x, y));
-            if (a >= alpha) {
-                rowFilled = true;
-                r = qMax(r, x);
-                if (l > x) {
-                    l = x;
-                }
-            }
-        }
-        if (rowFilled) {
-            t = qMin(t, y);
-            b = y;
+void PackContent::updateHash() {
+    const int geometry[] = { _image.width(), _image.height(), _rect.left(), _rect.top(), _rect.width(), _rect.height() };
+    uint hash = qHashBits(geometry, sizeof(geometry));
+
+    const QRect rect = _rect & _image.rect();
+    const int bytesPerPixel = _image.depth() / 8;
+    const int lineSize = rect.width() * bytesPerPixel;
+    if ((bytesPerPixel > 0) && (lineSize > 0)) {
+        for (int y = rect.top(); y <= rect.bottom(); ++y) {
+            hash = qHashBits(_image.constScanLine(y) + rect.left() * bytesPerPixel, lineSize, hash);
         }
     }
-    _rect = QRect(QPoint(l, t), QPoint(r,b));
+    _hash = hash;
+}
+
+void PackContent::trim(int alpha) {
+    _rect = alphaBounds(_image, alpha);
+    int l = _rect.left();
+    int t = _rect.top();
+    int r = _rect.right();
+    int b = _rect.bottom();
     if ((_rect.width() % 2) != (_image.width() % 2)) {
         if (l>0) l--; else r++;
         _rect = QRect(QPoint(l, t), QPoint(r,b));
@@ -87,8 +157,31 @@ SpriteAtlas::SpriteAtlas(const QStringList& sourceList, int textureBorder, int s
     _algorithm = "Rect";
     _rotateSprites = false;
     _polygonMode.enable = false;
+    _cachePath = SpriteCache::defaultPath();
+    _repackFillRatio = 0;
+    _previous.repackFillRatio = 0;
+
+    _aborted.storeRelease(0);
+}
+
+void SpriteAtlas::setPreviousAtlas(const SpriteAtlas& previous) {
+    _previous.layoutKey = previous.layoutKey();
+    _previous.outputData = previous._outputData;
+    _previous.repackFillRatio = previous._repackFillRatio;
+}
 
-    _aborted = false;
+QString SpriteAtlas::layoutKey() const {
+    return QString("%1;%2;%3;%4;%5;%6;%7;%8;%9")
+            .arg(_algorithm)
+            .arg(_textureBorder)
+            .arg(_spriteBorder)
+            .arg(_trim)
+            .arg(_heuristicMask)
+            .arg(_pow2)
+            .arg(_forceSquared)
+            .arg(_maxTextureSize)
+            .arg(_scale)
+            + QString(";%1;%2;%3").arg(_rotateSprites).arg(_polygonMode.enable).arg(_polygonMode.epsilon);
 }
 
 void SpriteAtlas::enablePolygonMode(bool enable, float epsilon) {
@@ -96,8 +189,91 @@ void SpriteAtlas::enablePolygonMode(bool enable, float epsilon) {
     _polygonMode.epsilon = epsilon;
 }
 
+namespace {
+
+    QImage applyHeuristicMask(const QImage& source) {
+        // same as QPixmap::setMask(createHeuristicMask()), but safe outside the GUI thread
+        QImage image = source.convertToFormat(QImage::Format_ARGB32);
+        QImage mask = image.createHeuristicMask();
+        for (int y=0; y<image.height(); ++y) {
+            QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+            const uchar* maskLine = mask.constScanLine(y);
+            for (int x=0; x<image.width(); ++x) {
+                if (!(maskLine[x >> 3] & (1 << (x & 7)))) {
+                    line[x] = 0;
+                }
+            }
+        }
+        return image;
+    }
+
+}
+
+bool SpriteAtlas::loadContent(const QString& filePath, const QString& name, PackContent& packContent) const {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    QByteArray fileData = file.readAll();
+    file.close();
+
+    QImage image;
+    if (!image.loadFromData(fileData)) return false;
+    if (_scale != 1) {
+        image = image.scaled(ceil(image.width() * _scale), ceil(image.height() * _scale), Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+
+    // Apply Heuristic mask
+    if (_heuristicMask) {
+        image = applyHeuristicMask(image);
+    }
+
+    // one pixel layout for every sprite, so identical sprites compare byte by byte
+    if (image.format() != QImage::Format_RGBA8888) {
+        image = image.convertToFormat(QImage::Format_RGBA8888);
+    }
+
+    packContent = PackContent(name, image);
+
+    // Trim / Crop
+    if (_trim) {
+        if (_polygonMode.enable) {
+            // polygon tracing is slow, reuse the result from the cache if the file and options are the same
+            SpriteCache cache(_cachePath);
+            QByteArray cacheKey;
+            SpriteCache::Entry entry;
+            if (cache.isEnabled()) {
+                QString options = QString("%1;%2;%3;%4").arg(_trim).arg(_scale).arg(_polygonMode.epsilon).arg(_heuristicMask);
+                cacheKey = cache.key(filePath, fileData, options);
+            }
+
+            if (cache.isEnabled() && cache.load(cacheKey, entry)) {
+                packContent.setRect(entry.rect);
+                packContent.setPolygons(entry.polygons);
+                packContent.setTriangles(entry.triangles);
+            } else {
+                packContent.trim(_trim);
+                //qDebug() << filePath;
+                PolygonImage polygonImage(packContent.image(), packContent.rect(), _polygonMode.epsilon, _trim);
+                packContent.setPolygons(polygonImage.polygons());
+                packContent.setTriangles(polygonImage.triangles());
+
+                if (cache.isEnabled()) {
+                    entry.rect = packContent.rect();
+                    entry.polygons = packContent.polygons();
+                    entry.triangles = packContent.triangles();
+                    cache.save(cacheKey, entry);
+                }
+            }
+        } else {
+            packContent.trim(_trim);
+        }
+    }
+    packContent.updateHash();
+
+    return true;
+}
+
 bool SpriteAtlas::generate(SpriteAtlasGenerateProgress* progress) {
-    _aborted = false;
+    _aborted.storeRelease(0);
 
     QTime timePerform;
     timePerform.start();
@@ -114,7 +290,7 @@ bool SpriteAtlas::generate(SpriteAtlasGenerateProgress* progress) {
 
     QList< QPair<QString, QString> > fileList;
     for(auto pathName: _sourceList) {
-        if (_aborted) return false;
+        if (_aborted.loadAcquire()) return false;
 
         QFileInfo fi(pathName);
 
@@ -122,7 +298,7 @@ bool SpriteAtlas::generate(SpriteAtlasGenerateProgress* progress) {
             QDir dir(fi.path());
             QDirIterator fileNames(pathName, nameFilter, QDir::Files | QDir::NoSymLinks | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
             while(fileNames.hasNext()){
-                if (_aborted) return false;
+                if (_aborted.loadAcquire()) return false;
 
                 fileNames.next();
                 fileList.push_back(qMakePair(fileNames.filePath(), dir.relativeFilePath(fileNames.filePath())));
@@ -137,41 +313,42 @@ bool SpriteAtlas::generate(SpriteAtlasGenerateProgress* progress) {
     // init images and rects
     _identicalFrames.clear();
 
-    int progressIndex = 1;
-    QVector<PackContent> inputContent;
-    auto it_f = fileList.begin();
-    for(; it_f != fileList.end(); ++it_f, ++progressIndex) {
-        if (_aborted) return false;
-
-        QImage image((*it_f).first);
-        if (image.isNull()) continue;
-        if (_scale != 1) {
-            image = image.scaled(ceil(image.width() * _scale), ceil(image.height() * _scale), Qt::KeepAspectRatio, Qt::SmoothTransformation);
-        }
+    // decode, scale, trim and trace all sprites on the thread pool,
+    // results keep the fileList order so the output is the same as a serial run
+    QVector<SpriteIngest> ingest(fileList.size());
+    for (int i=0; i<fileList.size(); ++i) {
+        ingest[i].filePath = fileList.at(i).first;
+        ingest[i].name = fileList.at(i).second;
+    }
+    QtConcurrent::blockingMap(ingest, [this](SpriteIngest& item) {
+        if (_aborted.loadAcquire()) return;
+        item.valid = loadContent(item.filePath, item.name, item.content);
+    });
+    if (_aborted.loadAcquire()) return false;
+
+    if (_polygonMode.enable && _trim) {
+        SpriteCache(_cachePath).prune();
+    }
 
-        // Apply Heuristic mask
-        if (_heuristicMask) {
-            QPixmap pix = QPixmap::fromImage(image);
-            pix.setMask(pix.createHeuristicMask());
-            image = pix.toImage();
-        }
+    if (_progress)
+        _progress->setProgressText(QString("Find identical sprites..."));
 
-        PackContent packContent((*it_f).second, image);
+    QElapsedTimer dedupTimer;
+    dedupTimer.start();
 
-        // Trim / Crop
-        if (_trim) {
-            packContent.trim(_trim);
-            if (_polygonMode.enable) {
-                //qDebug() << (*it_f).first;
-                PolygonImage polygonImage(packContent.image(), packContent.rect(), _polygonMode.epsilon, _trim);
-                packContent.setPolygons(polygonImage.polygons());
-                packContent.setTriangles(polygonImage.triangles());
-            }
-        }
+    // full compare only for sprites with the same content hash
+    QVector<PackContent> inputContent;
+    QMultiHash<uint, int> contentIndex;
+    for (auto it_i = ingest.begin(); it_i != ingest.end(); ++it_i) {
+        if (_aborted.loadAcquire()) return false;
+        if (!(*it_i).valid) continue;
+
+        const PackContent& packContent = (*it_i).content;
 
         // Find Identical
         bool findIdentical = false;
-        for (auto& content: inputContent) {
+        for (auto it_h = contentIndex.find(packContent.hash()); it_h != contentIndex.end() && it_h.key() == packContent.hash(); ++it_h) {
+            const PackContent& content = inputContent.at(it_h.value());
             if (content.isIdentical(packContent)) {
                 findIdentical = true;
                 _identicalFrames[content.name()].push_back(packContent.name());
@@ -184,17 +361,35 @@ bool SpriteAtlas::generate(SpriteAtlasGenerateProgress* progress) {
             continue;
         }
 
+        contentIndex.insert(packContent.hash(), inputContent.size());
         inputContent.push_back(packContent);
     }
+
+    qint64 dedupElapsed = dedupTimer.elapsed();
+    qDebug() << "Identical sprites:" << skipSprites << "time:" << dedupElapsed << "ms";
+    if (_progress)
+        _progress->setProgressText(QString("Identical sprites: %1 (%2 ms)").arg(skipSprites).arg(dedupElapsed));
+
     if (skipSprites)
         qDebug() << "Total skip sprites: " << skipSprites;
 
     bool result = false;
-    if ((_algorithm == "Polygon") && (_polygonMode.enable)) {
+    if (_algorithm.startsWith("Polygon") && (_polygonMode.enable)) {
         result = packWithPolygon(inputContent);
     } else {
-        result = packWithRect(inputContent);
+        // Skyline never places below its outline, so kept sprites can't be reserved
+        if ((_previous.outputData.size() == 1) && (_previous.layoutKey == layoutKey()) && (_algorithm != "Skyline")) {
+            result = packIncremental(inputContent);
+            if (!result && !_aborted.loadAcquire()) {
+                qDebug() << "Incremental update failed, full repack.";
+                _outputData.clear();
+            }
+        }
+        if (!result) {
+            result = packWithRect(inputContent);
+        }
     }
+    _previous = TPrevious();
 
     int elapsed = timePerform.elapsed();
     qDebug() << "Generate time mc:" <<  elapsed/1000.f << "sec";
@@ -206,14 +401,113 @@ bool SpriteAtlas::packWithRect(const QVector<PackContent>& content) {
     if (_progress)
         _progress->setProgressText("Optimizing atlas...");
 
+    QVector<int> items(content.size());
+    std::iota(items.begin(), items.end(), 0);
+
+    OutputData outputData;
+    if (packRectPage(content, items, outputData)) {
+        _outputData.push_back(outputData);
+        _repackFillRatio = outputData._fillRatio;
+        return true;
+    }
+    if (_aborted.loadAcquire()) return false;
+
+    qDebug() << "Max size Limit!";
+    return packRectPages(content);
+}
+
+bool SpriteAtlas::packRectPages(const QVector<PackContent>& content) {
+    // every sprite must fit into an empty page
+    const int canvasSize = _maxTextureSize - _textureBorder*2;
+    qint64 contentArea = 0;
+    QVector<QPair<qint64, int>> order;
+    for (int i=0; i<content.size(); ++i) {
+        int width = content[i].rect().width() + _spriteBorder;
+        int height = content[i].rect().height() + _spriteBorder;
+        if ((width > canvasSize) || (height > canvasSize)) {
+            qDebug() << "Sprite is bigger than max texture size:" << content[i].name() << width << height;
+            return false;
+        }
+        contentArea += (qint64)width * height;
+        order.push_back(qMakePair((qint64)width * height, i));
+    }
+    // biggest first
+    std::sort(order.begin(), order.end(), [](const QPair<qint64, int>& a, const QPair<qint64, int>& b) {
+        return (a.first != b.first)? (a.first > b.first) : (a.second < b.second);
+    });
+
+    struct RectPage {
+        QVector<int> items;
+        OutputData outputData;
+        bool success = false;
+    };
+
+    // spread sprites over pages by area (each sprite to the emptiest page), pack and compose
+    // all pages concurrently. Pages that fit are kept, the sprites of the pages that don't are
+    // spread again over one page more than failed
+    QVector<QPair<qint64, int>> pending = order;
+    int pageCount = qMax(2, (int)ceil((double)contentArea / ((qint64)canvasSize * canvasSize)));
+    while (!pending.isEmpty()) {
+        if (_aborted.loadAcquire()) return false;
+
+        pageCount = qMin(pageCount, pending.size());
+        if (_progress)
+            _progress->setProgressText(QString("Optimizing atlas pages: %1").arg(_outputData.size() + pageCount));
+
+        QVector<RectPage> pages(pageCount);
+        QVector<qint64> pageArea(pageCount, 0);
+        for (const auto& item: pending) {
+            int page = std::min_element(pageArea.begin(), pageArea.end()) - pageArea.begin();
+            pages[page].items.push_back(item.second);
+            pageArea[page] += item.first;
+        }
+
+        QtConcurrent::blockingMap(pages, [this, &content](RectPage& page) {
+            if (_aborted.loadAcquire()) return;
+            page.success = packRectPage(content, page.items, page.outputData);
+        });
+        if (_aborted.loadAcquire()) return false;
+
+        QSet<int> failed;
+        pageCount = 1;
+        for (const auto& page: pages) {
+            if (page.success) {
+                _outputData.push_back(page.outputData);
+                qDebug() << "Page" << _outputData.size() << "fill:" << page.outputData._fillRatio;
+            } else if (page.items.size() == 1) {
+                return false;
+            } else {
+                for (int index: page.items) failed.insert(index);
+                ++pageCount;
+            }
+        }
+
+        // keep biggest first order for the next deal
+        QVector<QPair<qint64, int>> next;
+        for (const auto& item: pending) {
+            if (failed.contains(item.second)) next.push_back(item);
+        }
+        pending = next;
+    }
+
+    if (_progress)
+        _progress->setProgressText(QString("Atlas pages: %1").arg(_outputData.size()));
+    return true;
+}
+
+// smallest atlas for the items of content and its image, false when it doesn't fit into max texture size
+bool SpriteAtlas::packRectPage(const QVector<PackContent>& content, const QVector<int>& items, OutputData& outputData) {
     int volume = 0;
-    BinPack2D::ContentAccumulator<PackContent> inputContent;
-    for (auto packContent: content) {
+    int contentArea = 0;
+    BinPack2D::ContentAccumulator<int> inputContent;
+    for (int index: items) {
+        const PackContent& packContent = content[index];
         int width = packContent.rect().width();
         int height = packContent.rect().height();
         volume += width * height * 1.02f;
+        contentArea += (width + _spriteBorder) * (height + _spriteBorder);
 
-        inputContent += BinPack2D::Content<PackContent>(packContent,
+        inputContent += BinPack2D::Content<int>(index,
                                                         BinPack2D::Coord(),
                                                         BinPack2D::Size(width + _spriteBorder, height + _spriteBorder),
                                                         _rotateSprites,
@@ -224,10 +518,78 @@ bool SpriteAtlas::packWithRect(const QVector<PackContent>& content) {
     inputContent.Sort();
 
     // A place to store packed content.
-    BinPack2D::ContentAccumulator<PackContent> remainder;
-    BinPack2D::ContentAccumulator<PackContent> outputContent;
+    BinPack2D::ContentAccumulator<int> outputContent;
 
     // find optimal size for atlas
+    int packCount = 0;
+
+    // lower bounds: total area of sprites and the biggest sprite
+    int minWidth = 0;
+    int minHeight = 0;
+    for (const auto& content: inputContent.Get()) {
+        if (_rotateSprites) {
+            minWidth = qMax(minWidth, qMin(content.size.w, content.size.h));
+            minHeight = minWidth;
+        } else {
+            minWidth = qMax(minWidth, content.size.w);
+            minHeight = qMax(minHeight, content.size.h);
+        }
+    }
+    minWidth += _textureBorder*2;
+    minHeight += _textureBorder*2;
+
+    // one full pack into w x h atlas, sizes below the bounds fail without packing.
+    // The packer is not monotone in the size (a size may fail while a smaller one fits),
+    // so the smallest layout of all packs is kept, not the last one.
+    QSize bestSize;
+    auto tryPack = [&](int width, int height) -> bool {
+        if ((width < minWidth) || (height < minHeight) ||
+                ((qint64)(width - _textureBorder*2) * (height - _textureBorder*2) < contentArea)) {
+            return false;
+        }
+        packCount++;
+        BinPack2D::ContentAccumulator<int> output;
+        if (!placeRects(_algorithm, width - _textureBorder*2, height - _textureBorder*2, inputContent.Get(), output.Get())) {
+            return false;
+        }
+        if (bestSize.isEmpty() || ((qint64)width * height < (qint64)bestSize.width() * bestSize.height())) {
+            bestSize = QSize(width, height);
+            outputContent = output;
+        }
+        return true;
+    };
+
+    // smallest value in (fail, fit] that packs, fit is known to pack. Stops at 1% of the
+    // value, the step pass below finishes it.
+    auto searchSize = [&](int fail, int fit, const std::function<bool(int)>& pack) -> int {
+        while ((fit - fail > qMax(1, fit / 100)) && !_aborted.loadAcquire()) {
+            int mid = (fail + fit) / 2;
+            if (pack(mid)) {
+                fit = mid;
+            } else {
+                fail = mid;
+            }
+        }
+        return fit;
+    };
+
+    // shrinks value with halving steps, at most 4 packs
+    auto shrinkSize = [&](int value, int step, const std::function<bool(int)>& pack) -> int {
+        for (int i=0; (i<4) && (step > 0) && !_aborted.loadAcquire(); ) {
+            if (value - step <= 0) {
+                step /= 2;
+                continue;
+            }
+            ++i;
+            if (pack(value - step)) {
+                value -= step;
+            } else {
+                step /= 2;
+            }
+        }
+        return value;
+    };
+
     int w = qMin(_maxTextureSize, (int)sqrt(volume));
     int h = qMin(_maxTextureSize, (int)sqrt(volume));
     if (_forceSquared) {
@@ -240,38 +602,12 @@ bool SpriteAtlas::packWithRect(const QVector<PackContent>& content) {
 
         bool k = true;
         while (1) {
-            if (_aborted) return false;
+            if (_aborted.loadAcquire()) return false;
 
-            BinPack2D::CanvasArray<PackContent> canvasArray = BinPack2D::UniformCanvasArrayBuilder<PackContent>(w - _textureBorder*2, h - _textureBorder*2, 1).Build();
-
-            bool success = canvasArray.Place(inputContent, remainder);
-            if (success) {
-                outputContent = BinPack2D::ContentAccumulator<PackContent>();
-                canvasArray.CollectContent(outputContent);
+            if (tryPack(w, h)) {
                 break;
-            } else {
-                if ((w == _maxTextureSize) && (h == _maxTextureSize)) {
-                    qDebug() << "Max size Limit!";
-                    //typedef BinPack2D::Content<PackContent>::Vector::iterator binpack2d_iterator;
-                    QVector<PackContent> remainderContent;
-                    for (auto itor = remainder.Get().begin(); itor != remainder.Get().end(); itor++ ) {
-                        const BinPack2D::Content<PackContent> &content = *itor;
-
-                        const PackContent &packContent = content.content;
-                        remainderContent.push_back(packContent);
-
-                        qDebug() << packContent.name() << content.size.w << content.size.h;
-                    }
-                    qDebug() << "content:" << content.size();
-                    qDebug() << "remainderContent:" << remainderContent.size();
-
-                    outputContent = BinPack2D::ContentAccumulator<PackContent>();
-                    canvasArray.CollectContent(outputContent);
-
-                    packWithRect(remainderContent);
-
-                    break;
-                }
+            } else if ((w == _maxTextureSize) && (h == _maxTextureSize)) {
+                return false;
             }
             if (k || _forceSquared) {
                 k = false;
@@ -286,274 +622,352 @@ bool SpriteAtlas::packWithRect(const QVector<PackContent>& content) {
             qDebug() << "Resize for bigger:" << w << "x" << h;
         }
         while (w > 2) {
-            if (_aborted) return false;
+            if (_aborted.loadAcquire()) return false;
 
             w = w/2;
             if (_forceSquared) {
                 h = w;
             }
-            BinPack2D::CanvasArray<PackContent> canvasArray = BinPack2D::UniformCanvasArrayBuilder<PackContent>(w - _textureBorder*2, h - _textureBorder*2, 1).Build();
-
-            bool success = canvasArray.Place(inputContent, remainder);
-            if (!success) {
+            if (!tryPack(w, h)) {
                 w = w*2;
                 if (_forceSquared) {
                     h = w;
                 }
                 break;
-            } else {
-                outputContent = BinPack2D::ContentAccumulator<PackContent>();
-                canvasArray.CollectContent(outputContent);
             }
             qDebug() << "Optimize width:" << w << "x" << h;
         }
         if (!_forceSquared) {
             while (h > 2) {
-                if (_aborted) return false;
+                if (_aborted.loadAcquire()) return false;
 
                 h = h/2;
-                BinPack2D::CanvasArray<PackContent> canvasArray = BinPack2D::UniformCanvasArrayBuilder<PackContent>(w - _textureBorder*2, h - _textureBorder*2, 1).Build();
-
-                bool success = canvasArray.Place(inputContent, remainder);
-                if (!success) {
+                if (!tryPack(w, h)) {
                     h = h*2;
                     break;
-                } else {
-                    outputContent = BinPack2D::ContentAccumulator<PackContent>();
-                    canvasArray.CollectContent(outputContent);
                 }
                 qDebug() << "Optimize height:" << w << "x" << h;
             }
         }
     } else {
-        qDebug() << "Volume size:" << w << "x" << h;
-        bool k = true;
-        int step = qMax((w + h) / 20, 1);
-        while (1) {
-            if (_aborted) return false;
-
-            BinPack2D::CanvasArray<PackContent> canvasArray = BinPack2D::UniformCanvasArrayBuilder<PackContent>(w - _textureBorder*2, h - _textureBorder*2, 1).Build();
-
-            bool success = canvasArray.Place(inputContent, remainder);
-            if (success) {
-                outputContent = BinPack2D::ContentAccumulator<PackContent>();
-                canvasArray.CollectContent(outputContent);
-                break;
-            } else {
-                if ((w == _maxTextureSize) && (h == _maxTextureSize)) {
-                    qDebug() << "Max size Limit!";
-                    //typedef BinPack2D::Content<PackContent>::Vector::iterator binpack2d_iterator;
-                    QVector<PackContent> remainderContent;
-                    for (auto itor = remainder.Get().begin(); itor != remainder.Get().end(); itor++ ) {
-                        const BinPack2D::Content<PackContent> &content = *itor;
-
-                        const PackContent &packContent = content.content;
-                        remainderContent.push_back(packContent);
-
-                        qDebug() << packContent.name() << content.size.w << content.size.h;
-                    }
-                    qDebug() << "content:" << content.size();
-                    qDebug() << "remainderContent:" << remainderContent.size();
-
-                    outputContent = BinPack2D::ContentAccumulator<PackContent>();
-                    canvasArray.CollectContent(outputContent);
-
-                    packWithRect(remainderContent);
-
-                    break;
-                }
+        int lower = qMax((int)ceil(sqrt((double)contentArea)) + _textureBorder*2, qMax(minWidth, minHeight));
+        lower = qBound(_textureBorder*2 + 1, lower, _maxTextureSize);
+        qDebug() << "Lower bound size:" << lower << "x" << lower;
+
+        // grow the square with doubling step from the lower bound until sprites fit,
+        // then bisect between the last fail and the first fit
+        int fail = lower - 1;
+        int side = lower;
+        int step = qMax(lower / 32, 1);
+        while (!tryPack(side, side)) {
+            if (_aborted.loadAcquire()) return false;
+
+            if (side == _maxTextureSize) {
+                return false;
             }
-            if (k || _forceSquared) {
-                k = false;
-                w = qMin(w + step, _maxTextureSize);
-            } else {
-                k = true;
-                h = qMin(h + step, _maxTextureSize);;
-            }
-            if (_forceSquared) {
-                h = w;
-            }
-
-            qDebug() << "Resize for bigger:" << w << "x" << h << "step:" << step;
+            fail = side;
+            side = qMin(side + step, _maxTextureSize);
+            step *= 2;
+            qDebug() << "Resize for bigger:" << side << "x" << side;
         }
-        step = qMax((w + h) / 20, 1);
-        while (w) {
-            if (_aborted) return false;
+        side = searchSize(fail, side, [&](int value) { return tryPack(value, value); });
+        w = side;
+        h = side;
+        qDebug() << "Optimize size:" << w << "x" << h;
 
-            w -= step;
-            if (_forceSquared) {
-                h = w;
-            }
-            BinPack2D::CanvasArray<PackContent> canvasArray = BinPack2D::UniformCanvasArrayBuilder<PackContent>(w - _textureBorder*2, h - _textureBorder*2, 1).Build();
+        if (!_forceSquared) {
+            // bisect width with fixed height, then height with fixed width
+            fail = qMax(minWidth, (int)ceil((double)contentArea / qMax(1, h - _textureBorder*2)) + _textureBorder*2) - 1;
+            w = searchSize(fail, w, [&](int value) { return tryPack(value, h); });
+            qDebug() << "Optimize width:" << w << "x" << h;
 
-            bool success = canvasArray.Place(inputContent, remainder);
-            if (!success) {
-                w += step;
-                if (_forceSquared) {
-                    h = w;
-                }
-                if (step > 1) step = qMax(step/2, 1); else break;
-            } else {
-                outputContent = BinPack2D::ContentAccumulator<PackContent>();
-                canvasArray.CollectContent(outputContent);
-            }
-            qDebug() << "Optimize width:" << w << "x" << h << "step:" << step;
+            fail = qMax(minHeight, (int)ceil((double)contentArea / qMax(1, w - _textureBorder*2)) + _textureBorder*2) - 1;
+            h = searchSize(fail, h, [&](int value) { return tryPack(w, value); });
+            qDebug() << "Optimize height:" << w << "x" << h;
         }
-        if (!_forceSquared) {
-            step = qMax((w + h) / 20, 1);
-            while (h) {
-                if (_aborted) return false;
-
-                h -= step;
-                BinPack2D::CanvasArray<PackContent> canvasArray = BinPack2D::UniformCanvasArrayBuilder<PackContent>(w - _textureBorder*2, h - _textureBorder*2, 1).Build();
-
-                bool success = canvasArray.Place(inputContent, remainder);
-                if (!success) {
-                    h += step;
-                    if (step > 1) step = qMax(step/2, 1); else break;
-                } else {
-                    outputContent = BinPack2D::ContentAccumulator<PackContent>();
-                    canvasArray.CollectContent(outputContent);
-                }
-                qDebug() << "Optimize height:" << w << "x" << h << "step:" << step;
-            }
+
+        // short step search below the best size, the bisection skips sizes that may fit
+        w = bestSize.width();
+        h = bestSize.height();
+        if (_forceSquared) {
+            shrinkSize(w, qMax((w + h) / 400, 1), [&](int value) { return tryPack(value, value); });
+        } else {
+            shrinkSize(w, qMax((w + h) / 400, 1), [&](int value) { return tryPack(value, h); });
+            w = bestSize.width();
+            h = bestSize.height();
+            shrinkSize(h, qMax((w + h) / 400, 1), [&](int value) { return tryPack(w, value); });
         }
+        if (_aborted.loadAcquire()) return false;
     }
+    w = bestSize.width();
+    h = bestSize.height();
 
-    qDebug() << "Found optimize size:" << w << "x" << h;
+    qDebug() << "Found optimize size:" << w << "x" << h << "packs:" << packCount;
     if (_progress)
-        _progress->setProgressText(QString("Found optimize size: %1x%2").arg(w).arg(h));
-
-    OutputData outputData;
+        _progress->setProgressText(QString("Found optimize size: %1x%2 (%3 packs)").arg(w).arg(h).arg(packCount));
 
     // parse output.
     outputData._atlasImage = QImage(w, h, QImage::Format_RGBA8888);
     outputData._atlasImage.fill(QColor(0, 0, 0, 0));
-    QPainter painter(&outputData._atlasImage);
+    QVector<BlitJob> blitJobs;
+    blitJobs.reserve(outputContent.Get().size());
     for(auto itor = outputContent.Get().begin(); itor != outputContent.Get().end(); itor++ ) {
-        if (_aborted) return false;
+        if (_aborted.loadAcquire()) return false;
 
-        const BinPack2D::Content<PackContent> &content = *itor;
+        const BinPack2D::Content<int> &placed = *itor;
 
         // retreive your data.
-        const PackContent &packContent = content.content;
+        const PackContent &packContent = content[placed.content];
         //qDebug() << packContent.mName << packContent.mRect;
 
-        // image
-        QImage image;
-        if (content.rotated) {
-            image = packContent.image().copy(packContent.rect());
-            image = rotate90(image);
-        }
+        QPoint coord(placed.coord.x, placed.coord.y);
+        QSize size(placed.size.w, placed.size.h);
 
-        SpriteFrameInfo spriteFrame;
-        spriteFrame.triangles = packContent.triangles();
-        spriteFrame.frame = QRect(content.coord.x + _textureBorder, content.coord.y + _textureBorder, content.size.w - _spriteBorder, content.size.h - _spriteBorder);
-        if (spriteFrame.triangles.indices.size()) {
-            spriteFrame.offset = QPoint(
-                        packContent.rect().left(),
-                        packContent.rect().top()
-                        );
-        } else {
-            spriteFrame.offset = QPoint(
-                        (packContent.rect().left() + (-packContent.image().width() + content.size.w - _spriteBorder) * 0.5f),
-                        (-packContent.rect().top() + ( packContent.image().height() - content.size.h + _spriteBorder) * 0.5f)
-                        );
-        }
-        spriteFrame.rotated = content.rotated;
-        spriteFrame.sourceColorRect = packContent.rect();
-        spriteFrame.sourceSize = packContent.image().size();
-        if (content.rotated) {
-            spriteFrame.frame = QRect(content.coord.x, content.coord.y, content.size.h-_spriteBorder, content.size.w-_spriteBorder);
+        blitJobs.push_back(rectBlitJob(packContent, coord, placed.rotated));
+        addSpriteFrame(outputData, packContent.name(), rectFrameInfo(packContent, coord, size, placed.rotated));
+        outputData._placements[packContent.name()] = SpritePlacement{coord, size, placed.rotated, packContent.hash()};
+    }
 
-        }
-        if (content.rotated) {
-            painter.drawImage(QPoint(content.coord.x + _textureBorder, content.coord.y + _textureBorder), image);
-        } else {
-            painter.drawImage(QPoint(content.coord.x + _textureBorder, content.coord.y + _textureBorder), packContent.image(), packContent.rect());
-        }
+    blitImages(outputData._atlasImage, blitJobs);
 
-        outputData._spriteFrames[packContent.name()] = spriteFrame;
+    outputData._fillRatio = (float)contentArea / qMax(1, (w - _textureBorder*2) * (h - _textureBorder*2));
 
-        // add ident to sprite frames
-        auto identicalIt = _identicalFrames.find(packContent.name());
-        if (identicalIt != _identicalFrames.end()) {
-            QStringList identicalList;
-            for (auto ident: (*identicalIt)) {
-                outputData._spriteFrames[ident] = spriteFrame;
+    return true;
+}
 
-                identicalList.push_back(ident);
+bool SpriteAtlas::packIncremental(const QVector<PackContent>& content) {
+    // full repack gets back this much of the fill, don't keep a layout worse than that
+    const float minFillFactor = 0.85f;
+
+    if (_progress)
+        _progress->setProgressText("Update atlas...");
+
+    const OutputData& previous = _previous.outputData.front();
+    const int w = previous._atlasImage.width();
+    const int h = previous._atlasImage.height();
+    const int canvasWidth = w - _textureBorder*2;
+    const int canvasHeight = h - _textureBorder*2;
+
+    // sprites with the same size stay where they were, the rest is placed in the free space
+    int contentArea = 0;
+    QSet<QString> keep;
+    QSet<QString> redraw;
+    BinPack2D::ContentAccumulator<int> keptContent;
+    BinPack2D::ContentAccumulator<int> newContent;
+    for (int index=0; index<content.size(); ++index) {
+        const PackContent& packContent = content[index];
+        int width = packContent.rect().width() + _spriteBorder;
+        int height = packContent.rect().height() + _spriteBorder;
+        contentArea += width * height;
+
+        auto placementIt = previous._placements.find(packContent.name());
+        if (placementIt != previous._placements.end()) {
+            const SpritePlacement& placement = *placementIt;
+            QSize size = placement.rotated? placement.size.transposed() : placement.size;
+            if (size == QSize(width, height)) {
+                keptContent += BinPack2D::Content<int>(index,
+                                                       BinPack2D::Coord(placement.coord.x(), placement.coord.y()),
+                                                       BinPack2D::Size(placement.size.width(), placement.size.height()),
+                                                       _rotateSprites,
+                                                       placement.rotated);
+                keep.insert(packContent.name());
+                if (placement.hash != packContent.hash()) {
+                    redraw.insert(packContent.name());
+                }
+                continue;
             }
         }
+
+        newContent += BinPack2D::Content<int>(index,
+                                              BinPack2D::Coord(),
+                                              BinPack2D::Size(width, height),
+                                              _rotateSprites,
+                                              false);
+        redraw.insert(packContent.name());
+    }
+
+    float fillRatio = (float)contentArea / qMax(1, canvasWidth * canvasHeight);
+    if (fillRatio < _previous.repackFillRatio * minFillFactor) {
+        qDebug() << "Atlas fragmented:" << fillRatio << "last repack:" << _previous.repackFillRatio;
+        return false;
+    }
+
+    newContent.Sort();
+    RectContentVector placedContent;
+    if (!placeRectsAround(_algorithm, canvasWidth, canvasHeight, keptContent.Get(), newContent.Get(), placedContent)) {
+        return false;
     }
 
+    if (_aborted.loadAcquire()) return false;
+
+    OutputData outputData;
+    outputData._atlasImage = previous._atlasImage;
+    outputData._fillRatio = fillRatio;
+
+    QPainter painter(&outputData._atlasImage);
+
+    // clear old images of removed, moved and changed sprites
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    for (auto it = previous._placements.begin(); it != previous._placements.end(); ++it) {
+        if (keep.contains(it.key()) && !redraw.contains(it.key())) continue;
+        painter.fillRect(QRect((*it).coord + QPoint(_textureBorder, _textureBorder), (*it).size), Qt::transparent);
+    }
     painter.end();
+
+    QVector<BlitJob> blitJobs;
+    for (const auto& placed: placedContent) {
+        if (_aborted.loadAcquire()) return false;
+
+        const PackContent &packContent = content[placed.content];
+
+        QPoint coord(placed.coord.x, placed.coord.y);
+        QSize size(placed.size.w, placed.size.h);
+
+        if (redraw.contains(packContent.name())) {
+            blitJobs.push_back(rectBlitJob(packContent, coord, placed.rotated));
+        }
+        addSpriteFrame(outputData, packContent.name(), rectFrameInfo(packContent, coord, size, placed.rotated));
+        outputData._placements[packContent.name()] = SpritePlacement{coord, size, placed.rotated, packContent.hash()};
+    }
+
+    blitImages(outputData._atlasImage, blitJobs);
     _outputData.push_front(outputData);
 
+    _repackFillRatio = _previous.repackFillRatio;
+
+    qDebug() << "Incremental update:" << redraw.size() << "of" << content.size() << "sprites redrawn";
+    if (_progress)
+        _progress->setProgressText(QString("Updated sprites: %1").arg(redraw.size()));
+
     return true;
 }
 
+SpriteFrameInfo SpriteAtlas::rectFrameInfo(const PackContent& packContent, const QPoint& coord, const QSize& size, bool rotated) const {
+    SpriteFrameInfo spriteFrame;
+    spriteFrame.triangles = packContent.triangles();
+    spriteFrame.frame = QRect(coord.x() + _textureBorder, coord.y() + _textureBorder, size.width() - _spriteBorder, size.height() - _spriteBorder);
+    if (spriteFrame.triangles.indices.size()) {
+        spriteFrame.offset = QPoint(
+                    packContent.rect().left(),
+                    packContent.rect().top()
+                    );
+    } else {
+        spriteFrame.offset = QPoint(
+                    (packContent.rect().left() + (-packContent.image().width() + size.width() - _spriteBorder) * 0.5f),
+                    (-packContent.rect().top() + ( packContent.image().height() - size.height() + _spriteBorder) * 0.5f)
+                    );
+    }
+    spriteFrame.rotated = rotated;
+    spriteFrame.sourceColorRect = packContent.rect();
+    spriteFrame.sourceSize = packContent.image().size();
+    if (rotated) {
+        spriteFrame.frame = QRect(coord.x(), coord.y(), size.height()-_spriteBorder, size.width()-_spriteBorder);
+
+    }
+    return spriteFrame;
+}
+
+BlitJob SpriteAtlas::rectBlitJob(const PackContent& packContent, const QPoint& coord, bool rotated) const {
+    return BlitJob{&packContent.image(), packContent.rect(), coord + QPoint(_textureBorder, _textureBorder), rotated, QImage()};
+}
+
+void SpriteAtlas::addSpriteFrame(OutputData& outputData, const QString& name, const SpriteFrameInfo& spriteFrame) const {
+    outputData._spriteFrames[name] = spriteFrame;
+
+    // add ident to sprite frames
+    auto identicalIt = _identicalFrames.find(name);
+    if (identicalIt != _identicalFrames.end()) {
+        for (auto ident: (*identicalIt)) {
+            outputData._spriteFrames[ident] = spriteFrame;
+        }
+    }
+}
+
 bool SpriteAtlas::packWithPolygon(const QVector<PackContent>& content) {
     if (_progress)
         _progress->setProgressText("Build pack contents...");
 
-    // initialize content
-    PolyPack2D::ContentList<PackContent> inputContent;
-    for (auto packContent: content) {
-        //TODO: remove convert
-        PolyPack2D::Triangles triangles;
-        for (auto vert: packContent.triangles().verts) {
-            triangles.verts.push_back(PolyPack2D::Point(vert.x(), vert.y()));
-        }
-        triangles.indices = packContent.triangles().indices.toStdVector();
-        inputContent += PolyPack2D::Content<PackContent>(packContent, triangles, _spriteBorder);
+    // initialize content, the packer grows the sprite triangles by the border and shares the indices
+    PolyPack2D::ContentList<int> inputContent;
+    for (int index=0; index<content.size(); ++index) {
+        const Triangles& triangles = content[index].triangles();
+        inputContent += PolyPack2D::Content<int>(index, triangles.verts, triangles.indices, _spriteBorder, _rotateSprites);
     }
 
     // Sort the input content by area... usually packs better.
     inputContent.sort();
 
     for (auto it = inputContent.begin(); it != inputContent.end(); ++it) {
-        qDebug() << (*it).content().name() << (*it).area();
+        qDebug() << content[(*it).content()].name() << (*it).area();
     }
 
-    PolyPack2D::Container<PackContent> container;
-    // TODO: abort this place if _aborted
-    container.place(inputContent, _maxTextureSize, 5, std::bind(&SpriteAtlas::onPlaceCallback, this, std::placeholders::_1, std::placeholders::_2));
-
-    auto outputContent = container.contentList();
+    PolyPack2D::ContentList<int> outputContent;
+    PolyPack2D::Rect bounds;
+    auto placeCallback = std::bind(&SpriteAtlas::onPlaceCallback, this, std::placeholders::_1, std::placeholders::_2);
+    auto isAborted = [this]() { return _aborted.loadAcquire() != 0; };
+    if (_algorithm == "Polygon-Grid") {
+        PolyPack2D::GridContainer<int> container;
+        if (!container.place(inputContent, _maxTextureSize, 5, placeCallback, isAborted)) return false;
+        outputContent = container.contentList();
+        bounds = container.bounds();
+    } else {
+        PolyPack2D::Container<int> container;
+        if (!container.place(inputContent, _maxTextureSize, 5, placeCallback, isAborted)) return false;
+        outputContent = container.contentList();
+        bounds = container.bounds();
+    }
 
     OutputData outputData;
 
-    outputData._atlasImage = QImage(container.bounds().width() + _textureBorder * 2, container.bounds().height() + _textureBorder * 2, QImage::Format_RGBA8888);
+    outputData._atlasImage = QImage(bounds.width() + _textureBorder * 2, bounds.height() + _textureBorder * 2, QImage::Format_RGBA8888);
     outputData._atlasImage.fill(QColor(0, 0, 0, 0));
 
-    QPainter painter(&outputData._atlasImage);
+    double contentArea = 0;
+    QVector<BlitJob> blitJobs;
+    blitJobs.reserve(outputContent.size());
     for(auto itor = outputContent.begin(); itor != outputContent.end(); itor++ ) {
-        if (_aborted) return false;
+        if (_aborted.loadAcquire()) return false;
 
-        const PolyPack2D::Content<PackContent> &content = *itor;
+        const PolyPack2D::Content<int> &placed = *itor;
 
         // retreive your data.
-        const PackContent &packContent = content.content();
+        const PackContent &packContent = content[placed.content()];
         SpriteFrameInfo spriteFrame;
 
         spriteFrame.triangles = packContent.triangles();
-        spriteFrame.frame = QRect(QPoint(content.bounds().left + _textureBorder, content.bounds().top + _textureBorder), QPoint(content.bounds().right, content.bounds().bottom));
+        const Triangles& triangles = spriteFrame.triangles;
+        for (int i=0; i+2<triangles.indices.size(); i+=3) {
+            QPoint a = triangles.verts[triangles.indices[i+1]] - triangles.verts[triangles.indices[i]];
+            QPoint b = triangles.verts[triangles.indices[i+2]] - triangles.verts[triangles.indices[i]];
+            contentArea += qAbs((qint64)a.x() * b.y() - (qint64)a.y() * b.x()) * 0.5;
+        }
+        spriteFrame.frame = QRect(QPoint(placed.bounds().left + _textureBorder, placed.bounds().top + _textureBorder), QPoint(placed.bounds().right, placed.bounds().bottom));
         spriteFrame.offset = QPoint(
                     packContent.rect().left(),
                     packContent.rect().top()
                     );
-        spriteFrame.rotated = false;
+        spriteFrame.rotated = placed.isRotated();
         spriteFrame.sourceColorRect = packContent.rect();
         spriteFrame.sourceSize = packContent.image().size();
+        if (spriteFrame.rotated) {
+            // frame keeps the unrotated size, the sprite is turned 90 degrees clockwise inside it
+            spriteFrame.frame.setSize(spriteFrame.frame.size().transposed());
+        }
 
-        QPainterPath clipPath;
+        // only the pixels inside the polygons, the blitter turns mask and image together
+        QImage mask(packContent.rect().size(), QImage::Format_Alpha8);
+        mask.fill(0);
+        QPainterPath maskPath;
         for (auto polygon: packContent.polygons()) {
-            clipPath.addPolygon(QPolygonF(QVector<QPointF>::fromStdVector(polygon)));
+            maskPath.addPolygon(QPolygonF(QVector<QPointF>::fromStdVector(polygon)));
         }
-        clipPath.translate(content.bounds().left + _textureBorder, content.bounds().top + _textureBorder);
-        painter.setClipPath(clipPath);
-        painter.drawImage(QPoint(content.bounds().left + _textureBorder, content.bounds().top + _textureBorder), packContent.image(), packContent.rect());
+        QPainter maskPainter(&mask);
+        maskPainter.fillPath(maskPath, Qt::white);
+        maskPainter.end();
+
+        blitJobs.push_back(BlitJob{&packContent.image(), packContent.rect(),
+                                   QPoint(placed.bounds().left + _textureBorder, placed.bounds().top + _textureBorder),
+                                   spriteFrame.rotated, mask});
 
         outputData._spriteFrames[packContent.name()] = spriteFrame;
 
@@ -569,7 +983,8 @@ bool SpriteAtlas::packWithPolygon(const QVector<PackContent>& content) {
         }
     }
 
-    painter.end();
+    blitImages(outputData._atlasImage, blitJobs);
+    outputData._fillRatio = contentArea / qMax(1.f, bounds.width() * bounds.height());
     _outputData.push_front(outputData);
 
     return true;
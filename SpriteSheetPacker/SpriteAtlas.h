@@ -3,8 +3,10 @@
 
 #include <QtCore>
 #include <QImage>
+#include <QPainter>
 
 #include "PolygonImage.h"
+#include "ImageBlit.h"
 
 struct SpriteFrameInfo {
 public:
@@ -17,13 +19,23 @@ public:
     Triangles triangles;
 };
 
+// where the rect packer put a sprite, coord and size without texture border
+struct SpritePlacement {
+    QPoint  coord;
+    QSize   size;
+    bool    rotated;
+    uint    hash;
+};
+
 class PackContent {
 public:
     PackContent();
     PackContent(const QString& name, const QImage& image);
 
-    bool isIdentical(const PackContent& other);
+    bool isIdentical(const PackContent& other) const;
     void trim(int alpha);
+    void updateHash();
+    void setRect(const QRect& rect) { _rect = rect; }
     void setTriangles(const Triangles& triangles) { _triangles = triangles; }
     void setPolygons(const Polygons& polygons) { _polygons = polygons; }
 
@@ -32,6 +44,7 @@ public:
     const QRect& rect() const { return _rect; }
     const Triangles& triangles() const { return _triangles; }
     const Polygons& polygons() const { return _polygons; }
+    uint hash() const { return _hash; }
 
 private:
     QString _name;
@@ -39,6 +52,7 @@ private:
     QRect   _rect;
     Triangles _triangles;
     Polygons  _polygons;
+    uint      _hash;
 };
 
 class SpriteAtlasGenerateProgress: public QObject
@@ -62,6 +76,9 @@ public:
     struct OutputData {
         QImage _atlasImage;
         QMap<QString, SpriteFrameInfo> _spriteFrames;
+        QMap<QString, SpritePlacement> _placements;
+        // packed sprites area (triangles area for polygon packing) / page area, without texture border
+        float _fillRatio = 0;
     };
 
 public:
@@ -80,8 +97,14 @@ public:
 
     void setRotateSprites(bool value) { _rotateSprites = value; }
 
+    // folder for preprocessed sprites, empty string disables the cache
+    void setCachePath(const QString& path) { _cachePath = path; }
+
+    // keep the layout of previous result and only place added or resized sprites
+    void setPreviousAtlas(const SpriteAtlas& previous);
+
     bool generate(SpriteAtlasGenerateProgress* progress = nullptr);
-    void abortGeneration() { _aborted = true; }
+    void abortGeneration() { _aborted.storeRelease(1); }
 
     QString algorithm() const { return _algorithm; }
     float scale() const { return _scale; }
@@ -90,11 +113,21 @@ public:
     const QMap<QString, QVector<QString>>& identicalFrames() const { return _identicalFrames; }
 
 protected:
+    bool loadContent(const QString& filePath, const QString& name, PackContent& packContent) const;
+
     bool packWithRect(const QVector<PackContent>& content);
+    bool packRectPage(const QVector<PackContent>& content, const QVector<int>& items, OutputData& outputData);
+    bool packRectPages(const QVector<PackContent>& content);
+    bool packIncremental(const QVector<PackContent>& content);
     bool packWithPolygon(const QVector<PackContent>& content);
 
     void onPlaceCallback(int current, int count);
 
+    QString layoutKey() const;
+    SpriteFrameInfo rectFrameInfo(const PackContent& packContent, const QPoint& coord, const QSize& size, bool rotated) const;
+    BlitJob rectBlitJob(const PackContent& packContent, const QPoint& coord, bool rotated) const;
+    void addSpriteFrame(OutputData& outputData, const QString& name, const SpriteFrameInfo& spriteFrame) const;
+
 private:
     QStringList _sourceList;
     QString _algorithm;
@@ -112,14 +145,25 @@ private:
         bool enable;
         float epsilon;
     } _polygonMode;
+    QString _cachePath;
 
     SpriteAtlasGenerateProgress* _progress;
 
     // output data
     QVector<OutputData> _outputData;
     QMap<QString, QVector<QString>> _identicalFrames;
-
-    bool _aborted;
+    // fill of the last full rect pack, incremental updates fall back to it when fill drops
+    float _repackFillRatio;
+
+    // previous result for incremental update
+    struct TPrevious {
+        QString layoutKey;
+        QVector<OutputData> outputData;
+        float repackFillRatio;
+    } _previous;
+
+    // set from the GUI thread, read by the pack and trace workers
+    QAtomicInt _aborted;
 };
 
 #endif // SPRITEATLAS_H
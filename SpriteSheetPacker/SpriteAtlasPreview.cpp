@@ -61,8 +61,6 @@ void SpriteAtlasPreview::setAtlas(const SpriteAtlas& atlas, PixelFormat pixelFor
         brushColor.setAlpha(100);
         QColor polygonColor(Qt::darkGreen);
         polygonColor.setAlpha(100);
-        QColor convexColor(Qt::yellow);
-        convexColor.setAlpha(100);
 
         for(auto it = spriteFrames.begin(); it != spriteFrames.end(); ++it) {
             bool skip = false;
@@ -80,7 +78,7 @@ void SpriteAtlasPreview::setAtlas(const SpriteAtlas& atlas, PixelFormat pixelFor
             auto spriteFrame = it.value();
             QPoint delta = spriteFrame.frame.topLeft();
 
-            if (atlas.algorithm() == "Rect") {
+            if (!atlas.algorithm().startsWith("Polygon")) {
                 auto rectItem = _scene->addRect(spriteFrame.frame, QPen(Qt::white), QBrush(brushColor));
                 rectItem->setPos(atlasPixmapItem->pos());
                 rectItem->setToolTip(it.key());
@@ -88,10 +86,18 @@ void SpriteAtlasPreview::setAtlas(const SpriteAtlas& atlas, PixelFormat pixelFor
             }
 
             if (spriteFrame.triangles.indices.size()) {
+                // rotated sprites are turned 90 degrees clockwise in the texture
+                auto vertex = [&spriteFrame, &delta](int index) -> QPointF {
+                    const QPoint& v = spriteFrame.triangles.verts[spriteFrame.triangles.indices[index]];
+                    if (spriteFrame.rotated) {
+                        return QPointF(delta.x() + spriteFrame.sourceColorRect.height() - v.y(), delta.y() + v.x());
+                    }
+                    return v + delta;
+                };
                 for (int i=0; i<spriteFrame.triangles.indices.size(); i+=3) {
-                    QPointF v1 = spriteFrame.triangles.verts[spriteFrame.triangles.indices[i+0]] + delta;
-                    QPointF v2 = spriteFrame.triangles.verts[spriteFrame.triangles.indices[i+1]] + delta;
-                    QPointF v3 = spriteFrame.triangles.verts[spriteFrame.triangles.indices[i+2]] + delta;
+                    QPointF v1 = vertex(i+0);
+                    QPointF v2 = vertex(i+1);
+                    QPointF v3 = vertex(i+2);
 
                     auto triangleItem = _scene->addPolygon(QPolygonF() << v1 << v2 << v3, QPen(Qt::white), QBrush(polygonColor));
                     triangleItem->setPos(atlasPixmapItem->pos());
@@ -100,17 +106,6 @@ void SpriteAtlasPreview::setAtlas(const SpriteAtlas& atlas, PixelFormat pixelFor
                 }
             }
 
-    //        QPolygon polygon;
-    //        for (auto point: spriteFrame.triangles.debugPoints) {
-    //            polygon << QPoint(point.x(), point.y());
-    //        }
-    //        outlineItems.push_back(_scene->addPolygon(polygon, QPen(Qt::red), QBrush(convexColor)));
-
-    //        for (auto point: spriteFrame.triangles.debugPoints) {
-    //            auto rectItem = _scene->addRect(QRectF(point.x() + delta.x(), point.y() + delta.y(), 1, 1), QPen(Qt::red), QBrush(Qt::red));
-    //            outlineItems.push_back(rectItem);
-    //        }
-
             // show identical statistics
             auto identicalFrames = atlas.identicalFrames().find(it.key());
             if (identicalFrames != atlas.identicalFrames().end()) {
@@ -128,7 +123,10 @@ void SpriteAtlasPreview::setAtlas(const SpriteAtlas& atlas, PixelFormat pixelFor
         float ram = (atlasImage.width() * atlasImage.height() * 4) / 1024.f / 1024.f;
         if (!infoString.isEmpty())
             infoString += "\n";
-        infoString += QString("%1x%2x%3 (RAM: %4MB)").arg(atlasImage.width()).arg(atlasImage.height()).arg(4).arg(ram, 0, 'f', 2);
+        infoString += QString("%1x%2x%3 (RAM: %4MB, Fill: %5%)").arg(atlasImage.width()).arg(atlasImage.height()).arg(4).arg(ram, 0, 'f', 2).arg(outputData._fillRatio * 100, 0, 'f', 1);
+    }
+    if (atlas.outputData().size() > 1) {
+        infoString = QString("Pages: %1\n").arg(atlas.outputData().size()) + infoString;
     }
 
     ui->labelAtlasInfo->setText(infoString);
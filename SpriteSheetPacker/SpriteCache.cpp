@@ -0,0 +1,149 @@
+#include "SpriteCache.h"
+
+static const quint32 CACHE_MAGIC = 0x53535043; // SSPC
+static const quint32 CACHE_VERSION = 2;
+static const qint64 CACHE_MAX_SIZE = 512 * 1024 * 1024;
+static const int CACHE_MAX_AGE_DAYS = 30;
+// modification time is the last prune
+static const char* CACHE_PRUNE_STAMP = ".pruned";
+
+SpriteCache::SpriteCache(const QString& path)
+    : _path(path)
+{
+
+}
+
+QString SpriteCache::defaultPath() {
+    QString cacheLocation = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (cacheLocation.isEmpty()) return QString();
+    return cacheLocation + "/sprites";
+}
+
+QByteArray SpriteCache::key(const QString& filePath, const QByteArray& fileData, const QString& options) const {
+    QFileInfo fi(filePath);
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(CACHE_VERSION));
+    hash.addData(fi.absoluteFilePath().toUtf8());
+    hash.addData(QByteArray::number(fi.lastModified().toMSecsSinceEpoch()));
+    hash.addData(QByteArray::number(fileData.size()));
+    hash.addData(QCryptographicHash::hash(fileData, QCryptographicHash::Sha1));
+    hash.addData(options.toUtf8());
+    return hash.result().toHex();
+}
+
+bool SpriteCache::load(const QByteArray& key, Entry& entry) const {
+    if (!isEnabled()) return false;
+
+    QFile file(_path + "/" + key);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic, version;
+    in >> magic >> version;
+    if ((in.status() != QDataStream::Ok) || (magic != CACHE_MAGIC) || (version != CACHE_VERSION)) {
+        file.remove();
+        return false;
+    }
+
+    Entry result;
+    in >> result.rect;
+
+    quint32 polygonCount;
+    in >> polygonCount;
+    for (quint32 i=0; (i < polygonCount) && (in.status() == QDataStream::Ok); ++i) {
+        quint32 pointCount;
+        in >> pointCount;
+        std::vector<QPointF> polygon;
+        for (quint32 p=0; (p < pointCount) && (in.status() == QDataStream::Ok); ++p) {
+            QPointF point;
+            in >> point;
+            polygon.push_back(point);
+        }
+        result.polygons.push_back(polygon);
+    }
+
+    in >> result.triangles.verts >> result.triangles.indices;
+
+    if (in.status() != QDataStream::Ok) {
+        file.remove();
+        return false;
+    }
+
+    entry = result;
+
+    // mark as used for prune(), on older Qt an entry ages from its save
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+    file.close();
+    if (file.open(QIODevice::Append)) {
+        file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    }
+#endif
+    return true;
+}
+
+bool SpriteCache::save(const QByteArray& key, const Entry& entry) const {
+    if (!isEnabled()) return false;
+    if (!QDir().mkpath(_path)) return false;
+
+    // write to temp file and rename, other threads can read the same key at the moment
+    QSaveFile file(_path + "/" + key);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+
+    out << CACHE_MAGIC << CACHE_VERSION;
+    out << entry.rect;
+
+    out << (quint32)entry.polygons.size();
+    for (const auto& polygon: entry.polygons) {
+        out << (quint32)polygon.size();
+        for (const auto& point: polygon) {
+            out << point;
+        }
+    }
+
+    out << entry.triangles.verts << entry.triangles.indices;
+
+    return file.commit();
+}
+
+void SpriteCache::prune() const {
+    if (!isEnabled()) return;
+
+    // listing the whole cache on every generate costs more than it saves
+    QFile stamp(_path + "/" + CACHE_PRUNE_STAMP);
+    QFileInfo stampInfo(stamp);
+    if (stampInfo.exists() && (stampInfo.lastModified() > QDateTime::currentDateTime().addDays(-1))) return;
+    if (!QDir().mkpath(_path) || !stamp.open(QIODevice::WriteOnly | QIODevice::Truncate)) return;
+    stamp.write(QDateTime::currentDateTime().toString(Qt::ISODate).toUtf8());
+    stamp.close();
+
+    const QDateTime expired = QDateTime::currentDateTime().addDays(-CACHE_MAX_AGE_DAYS);
+    const int keyLength = 40; // hex sha1
+
+    // most recently used first
+    QFileInfoList entries = QDir(_path).entryInfoList(QDir::Files | QDir::NoDotAndDotDot, QDir::Time);
+    qint64 size = 0;
+    int removed = 0;
+    for (const QFileInfo& fi: entries) {
+        bool remove = (fi.lastModified() < expired);
+        if (fi.fileName().size() == keyLength) {
+            remove = remove || (size + fi.size() > CACHE_MAX_SIZE);
+        }
+        // other names are temp files of QSaveFile, only removed when left over for long
+
+        if (!remove) {
+            size += fi.size();
+        } else if (QFile::remove(fi.filePath())) {
+            removed++;
+        }
+    }
+
+    if (removed) {
+        qDebug() << "Sprite cache pruned:" << removed << "files, size:" << size;
+    }
+}
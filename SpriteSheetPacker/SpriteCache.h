@@ -0,0 +1,41 @@
+#ifndef SPRITECACHE_H
+#define SPRITECACHE_H
+
+#include <QtCore>
+#include "PolygonImage.h"
+
+// On-disk cache of per sprite preprocessing (trim rect, polygons, triangles).
+// One file per sprite, named by a hash of the source file and the generate options,
+// the modification time of a file is its last use.
+class SpriteCache
+{
+public:
+    struct Entry {
+        QRect       rect;
+        Polygons    polygons;
+        Triangles   triangles;
+    };
+
+public:
+    SpriteCache(const QString& path = QString());
+
+    static QString defaultPath();
+
+    bool isEnabled() const { return !_path.isEmpty(); }
+    const QString& path() const { return _path; }
+
+    QByteArray key(const QString& filePath, const QByteArray& fileData, const QString& options) const;
+
+    bool load(const QByteArray& key, Entry& entry) const;
+    bool save(const QByteArray& key, const Entry& entry) const;
+
+    // removes entries not used for 30 days and the least recently used ones while
+    // the cache is bigger than 512 MB, at most once a day. Entries of other cache
+    // versions are never loaded (the version is part of the key), so they age out.
+    void prune() const;
+
+private:
+    QString _path;
+};
+
+#endif // SPRITECACHE_H
@@ -21,6 +21,9 @@ SpritePackerProjectFile::SpritePackerProjectFile() {
     _premultiplied = true;
     _pngOptMode = "None";
     _pngOptLevel = 7;
+    _pngQualityMin = 0;
+    _pngQualityMax = 100;
+    _pngEncodePreset = "Balanced";
     _jpgQuality = 80;
     _webpQuality = 80;
 
@@ -57,6 +60,9 @@ bool SpritePackerProjectFile::read(const QString &fileName) {
     if (json.contains("premultiplied")) _premultiplied = json["premultiplied"].toBool();
     if (json.contains("pngOptMode")) _pngOptMode = json["pngOptMode"].toString();
     if (json.contains("pngOptLevel")) _pngOptLevel = json["pngOptLevel"].toInt();
+    if (json.contains("pngQualityMin")) _pngQualityMin = json["pngQualityMin"].toInt();
+    if (json.contains("pngQualityMax")) _pngQualityMax = json["pngQualityMax"].toInt();
+    if (json.contains("pngEncodePreset")) _pngEncodePreset = json["pngEncodePreset"].toString();
     if (json.contains("webpQuality")) _webpQuality = json["webpQuality"].toInt();
     if (json.contains("jpgQuality")) _jpgQuality = json["jpgQuality"].toInt();
 
@@ -109,6 +115,9 @@ bool SpritePackerProjectFile::write(const QString &fileName) {
     json["premultiplied"] = _premultiplied;
     json["pngOptMode"] = _pngOptMode;
     json["pngOptLevel"] = _pngOptLevel;
+    json["pngQualityMin"] = _pngQualityMin;
+    json["pngQualityMax"] = _pngQualityMax;
+    json["pngEncodePreset"] = _pngEncodePreset;
     json["webpQuality"] = _webpQuality;
     json["jpgQuality"] = _jpgQuality;
 
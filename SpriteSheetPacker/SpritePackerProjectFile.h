@@ -58,6 +58,13 @@ public:
     void setPngOptLevel(int optLevel) { _pngOptLevel = optLevel; }
     int pngOptLevel() const { return _pngOptLevel; }
 
+    void setPngQuality(int minimum, int maximum) { _pngQualityMin = minimum; _pngQualityMax = maximum; }
+    int pngQualityMin() const { return _pngQualityMin; }
+    int pngQualityMax() const { return _pngQualityMax; }
+
+    void setPngEncodePreset(const QString& preset) { _pngEncodePreset = preset; }
+    const QString& pngEncodePreset() const { return _pngEncodePreset; }
+
     void setWebpQuality(int quality) { _webpQuality = quality; }
     int webpQuality() const { return _webpQuality; }
 
@@ -110,6 +117,9 @@ protected:
 
     QString     _pngOptMode;
     int         _pngOptLevel;
+    int         _pngQualityMin;
+    int         _pngQualityMax;
+    QString     _pngEncodePreset;
     int         _webpQuality;
     int         _jpgQuality;
 
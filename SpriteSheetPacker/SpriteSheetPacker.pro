@@ -43,7 +43,12 @@ SOURCES += main.cpp\
     ContentProtectionDialog.cpp \
     ZoomGraphicsView.cpp \
     AnimationDialog.cpp \
-    ElapsedTimer.cpp
+    ElapsedTimer.cpp \
+    ImageTrim.cpp \
+    ImageBlit.cpp \
+    ImageRotate.cpp \
+    PngEncoder.cpp \
+    SpriteCache.cpp
 
 HEADERS += MainWindow.h \
     ImageRotate.h \
@@ -64,12 +69,18 @@ HEADERS += MainWindow.h \
     ContentProtectionDialog.h \
     ZoomGraphicsView.h \
     AnimationDialog.h \
-    ElapsedTimer.h
+    ElapsedTimer.h \
+    ImageTrim.h \
+    ImageBlit.h \
+    PngEncoder.h \
+    SpriteCache.h
 
 #algorithm
 INCLUDEPATH += algorithm
 
 HEADERS += algorithm/binpack2d.hpp \
+    algorithm/maxrects2d.hpp \
+    algorithm/skyline2d.hpp \
     algorithm/triangle_triangle_intersection.h \
     algorithm/polypack2d.h
 
@@ -264,6 +264,13 @@ namespace BinPack2D {
 
         bool needToSort;
 
+        // uniform grid over the canvas, each cell lists indices of contents overlapping it,
+        // so Fits only tests placements near the candidate
+        int cellSize;
+        int gridW;
+        int gridH;
+        std::vector< std::vector<int> > grid;
+
     public:
 
         typedef Canvas<_T> CanvasT;
@@ -311,6 +318,11 @@ namespace BinPack2D {
         h(h)
         {
             topLefts.push_back( Coord(0,0) );
+
+            cellSize = std::max(32, std::max(w, h) / 128);
+            gridW = std::max(1, (w + cellSize - 1) / cellSize);
+            gridH = std::max(1, (h + cellSize - 1) / cellSize);
+            grid.resize(gridW * gridH);
         }
 
         bool HasContent() const {
@@ -385,6 +397,25 @@ namespace BinPack2D {
             return false;
         }
 
+        // stops at the first content that doesn't fit, for size search where the remainder is not needed
+        bool PlaceAll(const typename Content<_T>::Vector &contentVector) {
+
+            for( typename Content<_T>::Vector::const_iterator itor = contentVector.begin(); itor != contentVector.end(); itor++ )
+                if( Place( *itor ) == false )
+                    return false;
+
+            return true;
+        }
+
+        // place content at its own coord, used to keep a layout from a previous pack
+        bool Reserve(const Content<_T> &content) {
+
+            if( !Fits( content ) )
+                return false;
+
+            return Use( content );
+        }
+
     private:
 
         bool Fits( const Content<_T> &content ) const {
@@ -395,13 +426,30 @@ namespace BinPack2D {
             if( (content.coord.y + content.size.h) > h )
                 return false;
 
-            for( typename Content<_T>::Vector::const_iterator itor = contentVector.begin(); itor != contentVector.end(); itor++ )
-                if( content.intersects( *itor ) )
-                    return false;
+            int x0, y0, x1, y1;
+            CellRange(content, x0, y0, x1, y1);
+            for( int y = y0; y <= y1; y++ )
+                for( int x = x0; x <= x1; x++ ) {
+
+                    const std::vector<int> &cell = grid[y * gridW + x];
+                    for( std::vector<int>::const_iterator itor = cell.begin(); itor != cell.end(); itor++ )
+                        if( content.intersects( contentVector[*itor] ) )
+                            return false;
+                }
 
             return true;
         }
 
+        // cells under the content, at least one cell in each direction
+        // so that empty contents still see the ones around them
+        void CellRange( const Content<_T> &content, int &x0, int &y0, int &x1, int &y1 ) const {
+
+            x0 = std::min(std::max(content.coord.x / cellSize, 0), gridW - 1);
+            y0 = std::min(std::max(content.coord.y / cellSize, 0), gridH - 1);
+            x1 = std::min(std::max((content.coord.x + content.size.w - 1) / cellSize, x0), gridW - 1);
+            y1 = std::min(std::max((content.coord.y + content.size.h - 1) / cellSize, y0), gridH - 1);
+        }
+
         bool Use(const Content<_T> &content) {
 
             const Size  &size = content.size;
@@ -410,6 +458,12 @@ namespace BinPack2D {
             topLefts.push_front	( Coord( coord.x + size.w, coord.y          ) );
             topLefts.push_back	( Coord( coord.x         , coord.y + size.h ) );
 
+            int x0, y0, x1, y1;
+            CellRange(content, x0, y0, x1, y1);
+            for( int y = y0; y <= y1; y++ )
+                for( int x = x0; x <= x1; x++ )
+                    grid[y * gridW + x].push_back( (int)contentVector.size() );
+
             contentVector.push_back( content );
 
             needToSort = true;
@@ -0,0 +1,277 @@
+/**
+ * MaxRects2D is a single bin rectangle packer that tracks maximal free rectangles
+ * (Jukka Jylanki, "A Thousand Ways to Pack the Bin").
+ * Every placement splits the free rectangles it overlaps into at most four maximal ones
+ * and drops the ones contained in others, so there is no scan over placed contents.
+ *
+ * Uses BinPack2D::Content for input and output, and has the same Place/PlaceAll/Reserve/GetContents
+ * interface as BinPack2D::Canvas.
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <limits>
+#include <algorithm>
+#include "binpack2d.hpp"
+
+namespace MaxRects2D {
+
+    enum Heuristic {
+        BestShortSideFit,   // BSSF: smallest leftover on the short side
+        BestAreaFit,        // BAF: smallest free rectangle
+        BottomLeft,         // BL: lowest top edge, then leftmost
+        ContactPoint        // CP: longest edge touching the canvas and placed rectangles
+    };
+
+    struct Rect {
+        int x;
+        int y;
+        int w;
+        int h;
+
+        Rect(int x = 0, int y = 0, int w = 0, int h = 0)
+        : x(x), y(y), w(w), h(h)
+        {}
+
+        bool contains(const Rect &that) const {
+            return (that.x >= x) && (that.y >= y) && (that.x + that.w <= x + w) && (that.y + that.h <= y + h);
+        }
+
+        bool intersects(const Rect &that) const {
+            return (that.x < x + w) && (x < that.x + that.w) && (that.y < y + h) && (y < that.y + that.h);
+        }
+    };
+
+    template<typename _T> class Canvas {
+
+        std::vector<Rect> freeRects;
+        std::vector<Rect> usedRects;
+        typename BinPack2D::Content<_T>::Vector contentVector;
+        Heuristic heuristic;
+
+    public:
+
+        const int w;
+        const int h;
+
+        Canvas(int w, int h, Heuristic heuristic = BestShortSideFit)
+        : heuristic(heuristic),
+        w(w),
+        h(h)
+        {
+            if ((w > 0) && (h > 0))
+                freeRects.push_back( Rect(0, 0, w, h) );
+        }
+
+        const typename BinPack2D::Content<_T>::Vector &GetContents( ) const {
+
+            return contentVector;
+        }
+
+        bool Place(const typename BinPack2D::Content<_T>::Vector &contentVector, typename BinPack2D::Content<_T>::Vector &remainder) {
+
+            bool placedAll = true;
+
+            for( typename BinPack2D::Content<_T>::Vector::const_iterator itor = contentVector.begin(); itor != contentVector.end(); itor++ ) {
+
+                if( Place( *itor ) == false ) {
+
+                    placedAll = false;
+                    remainder.push_back( *itor );
+                }
+            }
+
+            return placedAll;
+        }
+
+        // stops at the first content that doesn't fit, for size search where the remainder is not needed
+        bool PlaceAll(const typename BinPack2D::Content<_T>::Vector &contentVector) {
+
+            for( typename BinPack2D::Content<_T>::Vector::const_iterator itor = contentVector.begin(); itor != contentVector.end(); itor++ )
+                if( Place( *itor ) == false )
+                    return false;
+
+            return true;
+        }
+
+        bool Place(BinPack2D::Content<_T> content) {
+
+            Rect best;
+            int bestScore1 = std::numeric_limits<int>::max();
+            int bestScore2 = std::numeric_limits<int>::max();
+            bool rotate = false;
+
+            bool found = FindPosition(content.size.w, content.size.h, best, bestScore1, bestScore2);
+            if (content.tryRotate && (content.size.w != content.size.h)) {
+                if (FindPosition(content.size.h, content.size.w, best, bestScore1, bestScore2)) {
+                    found = true;
+                    rotate = (best.w != content.size.w);
+                }
+            }
+            if (!found)
+                return false;
+
+            if (rotate)
+                content.Rotate();
+
+            content.coord = BinPack2D::Coord(best.x, best.y);
+            Use(best);
+            contentVector.push_back( content );
+
+            return true;
+        }
+
+        // keeps content at its coord, every free area is inside one of the maximal free rectangles
+        bool Reserve(const BinPack2D::Content<_T> &content) {
+
+            Rect used(content.coord.x, content.coord.y, content.size.w, content.size.h);
+
+            bool free = false;
+            for (const Rect &rect: freeRects) {
+                if (rect.contains(used)) {
+                    free = true;
+                    break;
+                }
+            }
+            if (!free)
+                return false;
+
+            Use(used);
+            contentVector.push_back( content );
+
+            return true;
+        }
+
+    private:
+
+        // scores are minimized, keeps the best of this and earlier calls in best/score1/score2
+        bool FindPosition(int width, int height, Rect &best, int &bestScore1, int &bestScore2) const {
+
+            bool found = false;
+
+            for (const Rect &free: freeRects) {
+
+                if ((free.w < width) || (free.h < height))
+                    continue;
+
+                int score1;
+                int score2;
+                switch (heuristic) {
+                    case BestAreaFit:
+                        score1 = free.w * free.h - width * height;
+                        score2 = std::min(free.w - width, free.h - height);
+                        break;
+                    case BottomLeft:
+                        score1 = free.y + height;
+                        score2 = free.x;
+                        break;
+                    case ContactPoint:
+                        score1 = -ContactScore(free.x, free.y, width, height);
+                        score2 = 0;
+                        break;
+                    case BestShortSideFit:
+                    default:
+                        score1 = std::min(free.w - width, free.h - height);
+                        score2 = std::max(free.w - width, free.h - height);
+                        break;
+                }
+
+                if ((score1 < bestScore1) || ((score1 == bestScore1) && (score2 < bestScore2))) {
+                    best = Rect(free.x, free.y, width, height);
+                    bestScore1 = score1;
+                    bestScore2 = score2;
+                    found = true;
+                }
+            }
+
+            return found;
+        }
+
+        static int CommonInterval(int a1, int a2, int b1, int b2) {
+
+            if ((a2 < b1) || (b2 < a1))
+                return 0;
+
+            return std::min(a2, b2) - std::max(a1, b1);
+        }
+
+        int ContactScore(int x, int y, int width, int height) const {
+
+            int score = 0;
+
+            if ((x == 0) || (x + width == w))
+                score += height;
+            if ((y == 0) || (y + height == h))
+                score += width;
+
+            for (const Rect &used: usedRects) {
+                if ((used.x == x + width) || (used.x + used.w == x))
+                    score += CommonInterval(used.y, used.y + used.h, y, y + height);
+                if ((used.y == y + height) || (used.y + used.h == y))
+                    score += CommonInterval(used.x, used.x + used.w, x, x + width);
+            }
+
+            return score;
+        }
+
+        void Use(const Rect &used) {
+
+            // split every free rectangle overlapping the used one into maximal pieces
+            std::vector<Rect> newRects;
+            for (size_t i = 0; i < freeRects.size(); ) {
+
+                const Rect free = freeRects[i];
+                if (!free.intersects(used)) {
+                    ++i;
+                    continue;
+                }
+
+                if (used.x > free.x)
+                    newRects.push_back( Rect(free.x, free.y, used.x - free.x, free.h) );
+                if (used.x + used.w < free.x + free.w)
+                    newRects.push_back( Rect(used.x + used.w, free.y, free.x + free.w - (used.x + used.w), free.h) );
+                if (used.y > free.y)
+                    newRects.push_back( Rect(free.x, free.y, free.w, used.y - free.y) );
+                if (used.y + used.h < free.y + free.h)
+                    newRects.push_back( Rect(free.x, used.y + used.h, free.w, free.y + free.h - (used.y + used.h)) );
+
+                freeRects[i] = freeRects.back();
+                freeRects.pop_back();
+            }
+
+            // free rectangles never contain each other, and a new piece is inside the old rectangle
+            // it was cut from, so only the new ones can be redundant
+            for (size_t i = 0; i < newRects.size(); ) {
+
+                bool contained = false;
+                for (size_t j = 0; (j < newRects.size()) && !contained; ++j)
+                    contained = (i != j) && newRects[j].contains(newRects[i]) && !(newRects[i].contains(newRects[j]) && (i < j));
+                for (size_t j = 0; (j < freeRects.size()) && !contained; ++j)
+                    contained = freeRects[j].contains(newRects[i]);
+
+                if (contained) {
+                    newRects[i] = newRects.back();
+                    newRects.pop_back();
+                } else {
+                    ++i;
+                }
+            }
+
+            freeRects.insert(freeRects.end(), newRects.begin(), newRects.end());
+
+            if (heuristic == ContactPoint)
+                usedRects.push_back(used);
+        }
+    };
+
+    inline Heuristic HeuristicFromString(const std::string &name) {
+
+        if (name == "BAF") return BestAreaFit;
+        if (name == "BL") return BottomLeft;
+        if (name == "CP") return ContactPoint;
+        return BestShortSideFit;
+    }
+
+} /*** MaxRects2D ***/
@@ -1,5 +1,7 @@
 #include "polypack2d.h"
 #include "triangle_triangle_intersection.h"
+#include <algorithm>
+#include <limits>
 
 namespace PolyPack2D {
     bool rectIntersect(const Rect& r1, const Rect& r2) {
@@ -10,12 +12,12 @@ namespace PolyPack2D {
     }
 
     bool trianglesIntersect(const Triangles& a, const Triangles& b) {
-        for (size_t i=0; i<a.indices.size(); i+=3) {
+        for (int i=0; i<a.indices.size(); i+=3) {
             float a1[2] = { a.verts[a.indices[i+0]].x, a.verts[a.indices[i+0]].y };
             float a2[2] = { a.verts[a.indices[i+1]].x, a.verts[a.indices[i+1]].y };
             float a3[2] = { a.verts[a.indices[i+2]].x, a.verts[a.indices[i+2]].y };
 
-            for (size_t j=0; j<b.indices.size(); j+=3) {
+            for (int j=0; j<b.indices.size(); j+=3) {
                 float b1[2] = { b.verts[b.indices[j+0]].x, b.verts[b.indices[j+0]].y };
                 float b2[2] = { b.verts[b.indices[j+1]].x, b.verts[b.indices[j+1]].y };
                 float b3[2] = { b.verts[b.indices[j+2]].x, b.verts[b.indices[j+2]].y };
@@ -27,4 +29,208 @@ namespace PolyPack2D {
         }
         return false;
     }
+
+    void TriangleTree::build(const Triangles& triangles) {
+        nodes.clear();
+        verts.clear();
+
+        int count = triangles.indices.size() / 3;
+        if (!count) return;
+
+        std::vector<int> order(count);
+        std::vector<Point> centers(count);
+        for (int i = 0; i < count; ++i) {
+            order[i] = i;
+            const Point& a = triangles.verts[triangles.indices[i * 3 + 0]];
+            const Point& b = triangles.verts[triangles.indices[i * 3 + 1]];
+            const Point& c = triangles.verts[triangles.indices[i * 3 + 2]];
+            centers[i] = Point((a.x + b.x + c.x) / 3, (a.y + b.y + c.y) / 3);
+        }
+
+        nodes.reserve(count * 2);
+        verts.reserve(count * 3);
+        build(order, 0, count, centers, triangles);
+    }
+
+    int TriangleTree::build(std::vector<int>& order, int begin, int end, const std::vector<Point>& centers, const Triangles& triangles) {
+        const int leafSize = 4;
+
+        Node node;
+        node.box.left = node.box.top = std::numeric_limits<float>::max();
+        node.box.right = node.box.bottom = -std::numeric_limits<float>::max();
+        for (int i = begin; i < end; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                const Point& p = triangles.verts[triangles.indices[order[i] * 3 + j]];
+                node.box.left = std::min(node.box.left, p.x);
+                node.box.top = std::min(node.box.top, p.y);
+                node.box.right = std::max(node.box.right, p.x);
+                node.box.bottom = std::max(node.box.bottom, p.y);
+            }
+        }
+        node.left = node.right = -1;
+        node.first = node.count = 0;
+
+        int index = nodes.size();
+        nodes.push_back(node);
+
+        if (end - begin <= leafSize) {
+            nodes[index].first = verts.size() / 3;
+            nodes[index].count = end - begin;
+            for (int i = begin; i < end; ++i) {
+                for (int j = 0; j < 3; ++j) {
+                    verts.push_back(triangles.verts[triangles.indices[order[i] * 3 + j]]);
+                }
+            }
+            return index;
+        }
+
+        // split at the median center along the longer side
+        bool splitX = node.box.width() >= node.box.height();
+        int middle = (begin + end) / 2;
+        std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end, [&centers, splitX](int a, int b) {
+            return splitX ? (centers[a].x < centers[b].x) : (centers[a].y < centers[b].y);
+        });
+
+        int left = build(order, begin, middle, centers, triangles);
+        int right = build(order, middle, end, centers, triangles);
+        nodes[index].left = left;
+        nodes[index].right = right;
+        return index;
+    }
+
+    static Rect moved(const Rect& rect, const Point& offset) {
+        Rect result = { rect.left + offset.x, rect.top + offset.y, rect.right + offset.x, rect.bottom + offset.y };
+        return result;
+    }
+
+    bool TriangleTree::intersects(const Point& offset, const TriangleTree& other, const Point& otherOffset) const {
+        if (nodes.empty() || other.nodes.empty()) return false;
+
+        std::vector<std::pair<int, int>> stack;
+        stack.push_back(std::make_pair(0, 0));
+        while (!stack.empty()) {
+            const Node& a = nodes[stack.back().first];
+            const Node& b = other.nodes[stack.back().second];
+            stack.pop_back();
+
+            if (!rectIntersect(moved(a.box, offset), moved(b.box, otherOffset))) continue;
+
+            bool leafA = (a.left < 0);
+            bool leafB = (b.left < 0);
+            if (leafA && leafB) {
+                for (int i = a.first; i < a.first + a.count; ++i) {
+                    float a1[2] = { verts[i * 3 + 0].x + offset.x, verts[i * 3 + 0].y + offset.y };
+                    float a2[2] = { verts[i * 3 + 1].x + offset.x, verts[i * 3 + 1].y + offset.y };
+                    float a3[2] = { verts[i * 3 + 2].x + offset.x, verts[i * 3 + 2].y + offset.y };
+
+                    for (int j = b.first; j < b.first + b.count; ++j) {
+                        float b1[2] = { other.verts[j * 3 + 0].x + otherOffset.x, other.verts[j * 3 + 0].y + otherOffset.y };
+                        float b2[2] = { other.verts[j * 3 + 1].x + otherOffset.x, other.verts[j * 3 + 1].y + otherOffset.y };
+                        float b3[2] = { other.verts[j * 3 + 2].x + otherOffset.x, other.verts[j * 3 + 2].y + otherOffset.y };
+
+                        if (tri_tri_overlap_test_2d(a1, a2, a3, b1, b2, b3)) {
+                            return true;
+                        }
+                    }
+                }
+            } else if (leafB || (!leafA && (a.box.area() >= b.box.area()))) {
+                // descend the bigger one
+                stack.push_back(std::make_pair(a.left, int(&b - &other.nodes[0])));
+                stack.push_back(std::make_pair(a.right, int(&b - &other.nodes[0])));
+            } else {
+                stack.push_back(std::make_pair(int(&a - &nodes[0]), b.left));
+                stack.push_back(std::make_pair(int(&a - &nodes[0]), b.right));
+            }
+        }
+        return false;
+    }
+
+    bool Mask::overlaps(const Mask& other, int x, int y) const {
+        int wordShift = x >> 6;
+        int bitShift = x & 63;
+        for (int row = 0; row < other.height; ++row) {
+            const uint64_t* src = &other.bits[row * other.stride];
+            const uint64_t* dst = &bits[(y + row) * stride + wordShift];
+            for (int i = 0; i < other.stride - 1; ++i) {
+                if (!src[i]) continue;
+                uint64_t lo = src[i] << bitShift;
+                uint64_t hi = bitShift ? (src[i] >> (64 - bitShift)) : 0;
+                if ((dst[i] & lo) || (dst[i + 1] & hi)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void Mask::add(const Mask& other, int x, int y) {
+        int wordShift = x >> 6;
+        int bitShift = x & 63;
+        for (int row = 0; row < other.height; ++row) {
+            const uint64_t* src = &other.bits[row * other.stride];
+            uint64_t* dst = &bits[(y + row) * stride + wordShift];
+            for (int i = 0; i < other.stride - 1; ++i) {
+                if (!src[i]) continue;
+                dst[i] |= src[i] << bitShift;
+                if (bitShift) dst[i + 1] |= src[i] >> (64 - bitShift);
+            }
+        }
+    }
+
+    // separating axis test of a triangle against the open box (left, top, right, bottom)
+    static bool triangleOverlapsBox(const Point* v, float left, float top, float right, float bottom) {
+        for (int i = 0; i < 3; ++i) {
+            const Point& a = v[i];
+            const Point& b = v[(i + 1) % 3];
+            float nx = b.y - a.y;
+            float ny = a.x - b.x;
+            if ((nx == 0) && (ny == 0)) continue;
+
+            float triMin = std::numeric_limits<float>::max();
+            float triMax = -std::numeric_limits<float>::max();
+            for (int j = 0; j < 3; ++j) {
+                float d = v[j].x * nx + v[j].y * ny;
+                triMin = std::min(triMin, d);
+                triMax = std::max(triMax, d);
+            }
+            float boxMin = std::min(left * nx, right * nx) + std::min(top * ny, bottom * ny);
+            float boxMax = std::max(left * nx, right * nx) + std::max(top * ny, bottom * ny);
+            if ((boxMax <= triMin) || (boxMin >= triMax)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Mask rasterize(const Triangles& triangles, float cellSize) {
+        float right = 0;
+        float bottom = 0;
+        for (auto point: triangles.verts) {
+            right = std::max(right, point.x);
+            bottom = std::max(bottom, point.y);
+        }
+
+        Mask mask(int(right / cellSize) + 1, int(bottom / cellSize) + 1);
+        for (int i = 0; i + 2 < triangles.indices.size(); i += 3) {
+            Point v[3] = {
+                triangles.verts[triangles.indices[i + 0]],
+                triangles.verts[triangles.indices[i + 1]],
+                triangles.verts[triangles.indices[i + 2]]
+            };
+
+            // cells of the triangle bounds, the box axes need no further test
+            int x0 = std::max(0, int(std::min({v[0].x, v[1].x, v[2].x}) / cellSize));
+            int y0 = std::max(0, int(std::min({v[0].y, v[1].y, v[2].y}) / cellSize));
+            int x1 = std::min(mask.width - 1, int(std::max({v[0].x, v[1].x, v[2].x}) / cellSize));
+            int y1 = std::min(mask.height - 1, int(std::max({v[0].y, v[1].y, v[2].y}) / cellSize));
+            for (int y = y0; y <= y1; ++y) {
+                for (int x = x0; x <= x1; ++x) {
+                    if (triangleOverlapsBox(v, x * cellSize, y * cellSize, (x + 1) * cellSize, (y + 1) * cellSize)) {
+                        mask.set(x, y);
+                    }
+                }
+            }
+        }
+        return mask;
+    }
 }
@@ -24,9 +24,15 @@
 #define POLYPACK2D_H
 
 #include <QPointF>
+#include <QVector>
 #include <QDebug>
+#include <QThread>
+#include <QtConcurrent>
 #include <math.h>
+#include <stdint.h>
+#include <atomic>
 #include <functional>
+#include <memory>
 
 namespace PolyPack2D {
 
@@ -95,36 +101,143 @@ namespace PolyPack2D {
 
     struct Triangles {
         std::vector<Point> verts;
-        std::vector<unsigned short> indices;
+        QVector<quint32> indices;   // implicitly shared with the sprite triangles
     };
 
     bool rectIntersect(const Rect& r1, const Rect& r2);
     bool trianglesIntersect(const Triangles& a, const Triangles& b);
+
+    // AABB tree over the triangles of a content, kept in the coordinates it was built in
+    // and tested at an offset, so probing a position doesn't copy or move any vertex
+    struct TriangleTree {
+        struct Node {
+            Rect box;
+            int left;   // children, or -1 for a leaf
+            int right;
+            int first;  // leaf triangles
+            int count;
+        };
+
+        std::vector<Node> nodes;
+        std::vector<Point> verts;   // 3 per triangle, in leaf order
+
+        void build(const Triangles& triangles);
+
+        // true if any triangle of this tree moved by offset overlaps a triangle of other moved by otherOffset
+        bool intersects(const Point& offset, const TriangleTree& other, const Point& otherOffset) const;
+
+    protected:
+        int build(std::vector<int>& order, int begin, int end, const std::vector<Point>& centers, const Triangles& triangles);
+    };
+
+    // occupancy bitmap with one bit per cell, rows padded to 64 bit words
+    struct Mask {
+        int width;
+        int height;
+        int stride;
+        std::vector<uint64_t> bits;
+
+        Mask(int _width = 0, int _height = 0)
+        : width(_width)
+        , height(_height)
+        , stride((_width + 63) / 64 + 1)
+        , bits(stride * _height, 0)
+        { }
+
+        void set(int x, int y) { bits[y * stride + (x >> 6)] |= uint64_t(1) << (x & 63); }
+
+        // other mask placed at cell x, y; it has to fit inside this one
+        bool overlaps(const Mask& other, int x, int y) const;
+        void add(const Mask& other, int x, int y);
+    };
+
+    // marks every cell whose interior is overlapped by a triangle, so cells
+    // that are free in both masks can't hold intersecting triangles
+    Mask rasterize(const Triangles& triangles, float cellSize);
     /////
 
 
+    inline Point toPoint(const Point& point) { return point; }
+    inline Point toPoint(const QPoint& point) { return Point(point.x(), point.y()); }
+
     template<class T> class Content {
     public:
-        Content(const T &content, Triangles triangles, int border = 0)
+        // triangles grown by border and moved to the origin, with their tree;
+        // built once per orientation and shared by all copies of the content
+        struct Shape {
+            Triangles triangles;
+            TriangleTree tree;
+            Rect bounds;
+            double area;
+        };
+
+        // verts are QPoint (sprite triangles) or Point, indices are shared, not copied
+        template <class Verts>
+        Content(const T &content, const Verts& verts, const QVector<quint32>& indices, int border = 0, bool tryRotate = false)
         : _content(content)
-        , _triangles(triangles)
-        , _area(0)
+        , _shape(makeShape(verts, indices, border))
+        , _tryRotate(tryRotate)
+        , _rotated(false)
         {
             _offset.x = _offset.y = 0;
-            _bounds.left = _bounds.top = std::numeric_limits<float>::max();
-            _bounds.right = _bounds.bottom = std::numeric_limits<float>::min();
+        }
+
+        // copy turned 90 degrees clockwise, (x, y) -> (-y, x) before it is moved back to the origin
+        Content rotated() const {
+            const Triangles& triangles = _shape->triangles;
+            std::vector<Point> verts(triangles.verts.size());
+            for (size_t v = 0; v < verts.size(); ++v) {
+                verts[v] = Point(-triangles.verts[v].y, triangles.verts[v].x);
+            }
+            Content content(_content, verts, triangles.indices, 0, _tryRotate);
+            content._rotated = !_rotated;
+            return content;
+        }
+
+        const T& content() const { return _content; }
+        double area() const { return _shape->area; }
+        const Point& offset() const { return _offset; }
+        Rect bounds() const {
+            Rect bounds = _shape->bounds;
+            bounds.left += _offset.x;
+            bounds.right += _offset.x;
+            bounds.top += _offset.y;
+            bounds.bottom += _offset.y;
+            return bounds;
+        }
+        // at the origin, offset() is not applied
+        const Triangles& triangles() const { return _shape->triangles; }
+        const TriangleTree& tree() const { return _shape->tree; }
+        const Point& treeOffset() const { return _offset; }
+        bool tryRotate() const { return _tryRotate; }
+        bool isRotated() const { return _rotated; }
+
+        void setOffset(const Point& offset) {
+            _offset = offset;
+        }
+
+    protected:
+        template <class Verts>
+        static std::shared_ptr<const Shape> makeShape(const Verts& verts, const QVector<quint32>& indices, int border) {
+            std::shared_ptr<Shape> shape = std::make_shared<Shape>();
+            Triangles& triangles = shape->triangles;
+            triangles.indices = indices;
+            triangles.verts.resize(verts.size());
+            for (size_t v = 0; v < triangles.verts.size(); ++v) {
+                triangles.verts[v] = toPoint(verts[v]);
+            }
 
             if (border) {
                 // calculate normals
-                std::vector<Point> norms(_triangles.verts.size());
-                for (size_t i = 0; i < _triangles.indices.size(); i += 3) {
-                    auto i1 = _triangles.indices[i + 0];
-                    auto i2 = _triangles.indices[i + 1];
-                    auto i3 = _triangles.indices[i + 2];
+                std::vector<Point> norms(triangles.verts.size());
+                for (int i = 0; i + 2 < triangles.indices.size(); i += 3) {
+                    auto i1 = triangles.indices[i + 0];
+                    auto i2 = triangles.indices[i + 1];
+                    auto i3 = triangles.indices[i + 2];
 
-                    Point v1(_triangles.verts[i1]);
-                    Point v2(_triangles.verts[i2]);
-                    Point v3(_triangles.verts[i3]);
+                    Point v1(triangles.verts[i1]);
+                    Point v2(triangles.verts[i2]);
+                    Point v3(triangles.verts[i3]);
 
                     Point n1 = (normal(v1, v3) + normal(v2, v1)).normalize();
                     Point n2 = (normal(v2, v1) + normal(v3, v2)).normalize();
@@ -136,60 +249,54 @@ namespace PolyPack2D {
                     norms[i3] = ((norms[i3] + n3) * 0.5f).normalize();
                 }
                 // increase polygons with normals
-                for (size_t v = 0; v < _triangles.verts.size(); ++v) {
-                    _triangles.verts[v] = _triangles.verts[v] + norms[v] * border;
+                for (size_t v = 0; v < triangles.verts.size(); ++v) {
+                    triangles.verts[v] = triangles.verts[v] + norms[v] * border;
                 }
             }
 
             // calculate bounding box
-            for (auto point: _triangles.verts) {
-                if (_bounds.left > point.x) _bounds.left = point.x;
-                if (_bounds.right < point.x) _bounds.right = point.x;
-                if (_bounds.top > point.y) _bounds.top = point.y;
-                if (_bounds.bottom < point.y) _bounds.bottom = point.y;
+            Rect& bounds = shape->bounds;
+            bounds.left = bounds.top = std::numeric_limits<float>::max();
+            bounds.right = bounds.bottom = std::numeric_limits<float>::min();
+            for (auto point: triangles.verts) {
+                if (bounds.left > point.x) bounds.left = point.x;
+                if (bounds.right < point.x) bounds.right = point.x;
+                if (bounds.top > point.y) bounds.top = point.y;
+                if (bounds.bottom < point.y) bounds.bottom = point.y;
             }
 
-            setOffset(Point(-_bounds.left, -_bounds.top));
-            _area = _bounds.area();
-        }
-        Content(const Content& other)
-            : _content(other._content)
-            , _offset(other.offset())
-            , _triangles(other._triangles)
-            , _area(other._area)
-            , _bounds(other._bounds)
-        {
-
-        }
-
-        const T& content() const { return _content; }
-        double area() const { return _area; }
-        const Point& offset() const { return _offset; }
-        const Rect& bounds() const { return _bounds; }
-        const Triangles& triangles() const { return _triangles; }
-
-        void setOffset(const Point& offset) {
-            _offset = offset;
-            _bounds.left += offset.x;
-            _bounds.right += offset.x;
-            _bounds.top += offset.y;
-            _bounds.bottom += offset.y;
-
-            // translate triangles
-            for (auto it_p = _triangles.verts.begin(); it_p != _triangles.verts.end(); ++it_p) {
-                (*it_p).x += offset.x;
-                (*it_p).y += offset.y;
+            // move to the origin
+            Point origin(-bounds.left, -bounds.top);
+            for (auto it_p = triangles.verts.begin(); it_p != triangles.verts.end(); ++it_p) {
+                (*it_p).x += origin.x;
+                (*it_p).y += origin.y;
             }
+            bounds.left += origin.x;
+            bounds.right += origin.x;
+            bounds.top += origin.y;
+            bounds.bottom += origin.y;
+            shape->area = bounds.area();
+
+            shape->tree.build(triangles);
+            return shape;
         }
 
-    protected:
         T _content;
         Point _offset;
-        Triangles _triangles;
-        double _area;
-        Rect _bounds;
+        std::shared_ptr<const Shape> _shape;
+        bool _tryRotate;
+        bool _rotated;
     };
 
+    // orientations tried for a content, the original first so it wins ties
+    template <class T> std::vector<Content<T>> variants(const Content<T>& content) {
+        std::vector<Content<T>> result(1, content);
+        if (content.tryRotate()) {
+            result.push_back(content.rotated());
+        }
+        return result;
+    }
+
     template <class T> class ContentList: public std::vector<Content<T>> {
     public:
         ContentList<T>& operator += (const Content<T>& content) {
@@ -208,74 +315,61 @@ namespace PolyPack2D {
 
     template <class T> class Container: public std::vector<Content<T>> {
     public:
-        void place(const ContentList<T>& inputContent, int sizeLimit = 8192, int step = 5, std::function<void (int, int)> callback = NULL) {
+        // returns false if aborted
+        bool place(const ContentList<T>& inputContent, int sizeLimit = 8192, int step = 5, std::function<void (int, int)> callback = NULL, std::function<bool ()> isAborted = NULL) {
             int contentIndex = 0;
             for (auto it = inputContent.begin(); it != inputContent.end(); ++it, ++contentIndex) {
+                if (isAborted && isAborted()) return false;
+
                 auto content = (*it);
                 // insert first
                 if (it == inputContent.begin()) {
                     _bounds = content.bounds();
                     _contentList.push_back(content);
                 } else {
+                    auto contentVariants = variants(content);
                     float startX = 0;//_bounds.left - (content.bounds().right - content.bounds().left) - step;
                     float startY = 0;//_bounds.top - (content.bounds().bottom - content.bounds().top) - step;
-                    float endX = _bounds.right + step + (content.bounds().right - content.bounds().left);
-                    float endY = _bounds.bottom + step + (content.bounds().bottom - content.bounds().top);
+                    float endX = 0;
+                    float endY = 0;
+                    for (auto& variant: contentVariants) {
+                        endX = std::max(endX, _bounds.right + step + (variant.bounds().right - variant.bounds().left));
+                        endY = std::max(endY, _bounds.bottom + step + (variant.bounds().bottom - variant.bounds().top));
+                    }
 
-                    bool isPlaces = false;
-                    float bestArea = 0;
-                    Point bestOffset;
+                    // rows are split into tiles evaluated concurrently, every tile keeps its best
+                    // candidate and the smallest (area, y, x, orientation) wins, same as the sequential scan
+                    std::vector<float> rows;
+                    for (float y = startY; y < endY; y+= step) {
+                        rows.push_back(y);
+                    }
 
-                    bool translateTriangles = false;
-                    Triangles contentTriangles;
+                    int tileCount = std::min((int)rows.size(), QThread::idealThreadCount() * 4);
+                    std::vector<Tile> tiles(tileCount);
+                    for (int i = 0; i < tileCount; ++i) {
+                        tiles[i].begin = rows.size() * i / tileCount;
+                        tiles[i].end = rows.size() * (i + 1) / tileCount;
+                    }
 
-                    for (float y = startY; y < endY; y+= step) {
-                        for (float x = startX; x < endX; x+= step) {
-                            auto contentBounds = content.bounds();
-                            contentBounds.left += x;
-                            contentBounds.right += x;
-                            contentBounds.top += y;
-                            contentBounds.bottom += y;
-
-                            auto newBounds(_bounds + contentBounds);
-                            float area = newBounds.area();
-                            if ((area > bestArea) && (isPlaces)) {
-                                continue;
-                            }
-//                            if (newBounds.width() > (newBounds.height()*2)) continue;
-//                            if (newBounds.height() > (newBounds.width()*2)) continue;
-                            if (newBounds.width() > sizeLimit) continue;
-                            if (newBounds.height() > sizeLimit) continue;
-
-                            translateTriangles = false;
-
-                            // test intersect intersection
-                            bool intersect = false;
-                            for (auto in_it = _contentList.begin(); in_it != _contentList.end(); ++in_it) {
-                                if (rectIntersect(contentBounds, (*in_it).bounds())) {
-                                    // translate triangles and test intersection
-                                    if (!translateTriangles) {
-                                        contentTriangles = content.triangles();
-                                        for (auto it_p = contentTriangles.verts.begin(); it_p != contentTriangles.verts.end(); ++it_p) {
-                                            (*it_p).x += x;
-                                            (*it_p).y += y;
-                                        }
-                                        translateTriangles = true;
-                                    }
-                                    if (trianglesIntersect(contentTriangles, (*in_it).triangles())) {
-                                        intersect = true;
-                                        break;
-                                    }
+                    std::atomic<float> sharedArea(std::numeric_limits<float>::max());
+                    QtConcurrent::blockingMap(tiles, [&](Tile& tile) {
+                        for (size_t row = tile.begin; row < tile.end; ++row) {
+                            if (isAborted && isAborted()) return;
+                            for (float x = startX; x < endX; x+= step) {
+                                for (size_t variant = 0; variant < contentVariants.size(); ++variant) {
+                                    evaluate(contentVariants[variant], variant, x, rows[row], sizeLimit, tile, sharedArea);
                                 }
                             }
+                        }
+                    });
+                    if (isAborted && isAborted()) return false;
 
-                            if (!intersect) {
-                                if ((!isPlaces) || (area < bestArea)) {
-                                    bestArea = area;
-                                    bestOffset = Point(x, y);
-                                    isPlaces = true;
-                                }
-                            }
+                    bool isPlaces = false;
+                    Tile best;
+                    for (auto& tile: tiles) {
+                        if (tile.isPlaces && (!isPlaces || (tile.bestArea < best.bestArea))) {
+                            best = tile;
+                            isPlaces = true;
                         }
                     }
 
@@ -284,25 +378,216 @@ namespace PolyPack2D {
                         if (callback)
                             callback(contentIndex, inputContent.size());
 
-                        content.setOffset(bestOffset);
-                        if (_bounds.left > content.bounds().left) _bounds.left = content.bounds().left;
-                        if (_bounds.right < content.bounds().right) _bounds.right = content.bounds().right;
-                        if (_bounds.top > content.bounds().top) _bounds.top = content.bounds().top;
-                        if (_bounds.bottom < content.bounds().bottom) _bounds.bottom = content.bounds().bottom;
-                        _contentList.push_back(content);
+                        Content<T> placed(contentVariants[best.bestVariant]);
+                        placed.setOffset(best.bestOffset);
+                        if (_bounds.left > placed.bounds().left) _bounds.left = placed.bounds().left;
+                        if (_bounds.right < placed.bounds().right) _bounds.right = placed.bounds().right;
+                        if (_bounds.top > placed.bounds().top) _bounds.top = placed.bounds().top;
+                        if (_bounds.bottom < placed.bounds().bottom) _bounds.bottom = placed.bounds().bottom;
+                        _contentList.push_back(placed);
                     } else {
                         qDebug() << "Not placed";
                     }
                 }
             }
+            return true;
+        }
+
+        const Rect& bounds() const { return _bounds; }
+        const ContentList<T>& contentList() const { return _contentList; }
+
+    protected:
+        struct Tile {
+            size_t begin;
+            size_t end;
+            bool isPlaces;
+            float bestArea;
+            Point bestOffset;
+            size_t bestVariant;
+
+            Tile(): begin(0), end(0), isPlaces(false), bestArea(0), bestVariant(0) { }
+        };
+
+        // tests one offset, sharedArea is the best area of all tiles so far and only used to skip
+        // candidates that can't win (ties are still tested, the earlier tile has to win them)
+        void evaluate(const Content<T>& content, size_t variant, float x, float y, int sizeLimit, Tile& tile, std::atomic<float>& sharedArea) const {
+            auto contentBounds = content.bounds();
+            contentBounds.left += x;
+            contentBounds.right += x;
+            contentBounds.top += y;
+            contentBounds.bottom += y;
+
+            auto newBounds(_bounds + contentBounds);
+            float area = newBounds.area();
+            if ((area > sharedArea.load(std::memory_order_relaxed)) || ((area >= tile.bestArea) && (tile.isPlaces))) {
+                return;
+            }
+//            if (newBounds.width() > (newBounds.height()*2)) return;
+//            if (newBounds.height() > (newBounds.width()*2)) return;
+            if (newBounds.width() > sizeLimit) return;
+            if (newBounds.height() > sizeLimit) return;
+
+            // test intersect intersection
+            Point offset = content.treeOffset() + Point(x, y);
+            for (auto in_it = _contentList.begin(); in_it != _contentList.end(); ++in_it) {
+                if (rectIntersect(contentBounds, (*in_it).bounds())) {
+                    if (content.tree().intersects(offset, (*in_it).tree(), (*in_it).treeOffset())) {
+                        return;
+                    }
+                }
+            }
+
+            tile.bestArea = area;
+            tile.bestOffset = Point(x, y);
+            tile.bestVariant = variant;
+            tile.isPlaces = true;
+
+            float shared = sharedArea.load(std::memory_order_relaxed);
+            while ((area < shared) && !sharedArea.compare_exchange_weak(shared, area, std::memory_order_relaxed)) { }
+        }
+
+        Rect _bounds;
+        ContentList<T> _contentList;
+    };
+
+    // Container's search (offsets on a step grid, smallest bounding area wins) with a rasterized
+    // occupancy grid as a conservative filter in front of the triangle test: an offset is rejected
+    // when a cell is marked by both masks, although triangles sharing a cell may not overlap. So
+    // some offsets Container accepts are skipped and layouts can be a bit bigger.
+    // Triangles are only tested for the offsets that improve the best area.
+    template <class T> class GridContainer: public std::vector<Content<T>> {
+    public:
+        // returns false if aborted
+        bool place(const ContentList<T>& inputContent, int sizeLimit = 8192, int step = 5, std::function<void (int, int)> callback = NULL, std::function<bool ()> isAborted = NULL) {
+            int cells = sizeLimit / step + 2;
+            _grid = Mask(cells, cells);
+
+            int contentIndex = 0;
+            for (auto it = inputContent.begin(); it != inputContent.end(); ++it, ++contentIndex) {
+                auto content = (*it);
+                // insert first
+                if (it == inputContent.begin()) {
+                    _bounds = content.bounds();
+                    _contentList.push_back(content);
+                    _grid.add(rasterize(content.triangles(), step), 0, 0);
+                    continue;
+                }
+
+                // every orientation is scanned concurrently, ties go to the earlier one
+                auto contentVariants = variants(content);
+                std::vector<Scan> scans(contentVariants.size());
+                for (size_t i = 0; i < scans.size(); ++i) {
+                    scans[i].variant = i;
+                }
+                QtConcurrent::blockingMap(scans, [&](Scan& scan) {
+                    const Content<T>& variant = contentVariants[scan.variant];
+                    scan.mask = rasterize(variant.triangles(), step);
+                    this->scan(variant, sizeLimit, step, scan, isAborted);
+                });
+                if (isAborted && isAborted()) return false;
+
+                const Scan* best = NULL;
+                for (auto& scan: scans) {
+                    if (scan.isPlaces && (!best || (scan.bestArea < best->bestArea))) {
+                        best = &scan;
+                    }
+                }
+
+                if (best) {
+                    qDebug() << "Placing: " << contentIndex << "/" << inputContent.size();
+                    if (callback)
+                        callback(contentIndex, inputContent.size());
+
+                    Content<T> placed(contentVariants[best->variant]);
+                    placed.setOffset(Point(best->bestX * step, best->bestY * step));
+                    _bounds = _bounds + placed.bounds();
+                    _contentList.push_back(placed);
+                    _grid.add(best->mask, best->bestX, best->bestY);
+                } else {
+                    qDebug() << "Not placed";
+                }
+            }
+            return true;
         }
 
         const Rect& bounds() const { return _bounds; }
         const ContentList<T>& contentList() const { return _contentList; }
 
     protected:
+        struct Scan {
+            size_t variant;
+            Mask mask;
+            bool isPlaces;
+            float bestArea;
+            int bestX;
+            int bestY;
+
+            Scan(): variant(0), isPlaces(false), bestArea(0), bestX(0), bestY(0) { }
+        };
+
+        void scan(const Content<T>& content, int sizeLimit, int step, Scan& scan, std::function<bool ()> isAborted) const {
+            const Mask& mask = scan.mask;
+            float contentWidth = content.bounds().right - content.bounds().left;
+            float contentHeight = content.bounds().bottom - content.bounds().top;
+            // same offsets as Container, which steps while x < end
+            int endX = (int)ceil((_bounds.right + step + contentWidth) / step);
+            int endY = (int)ceil((_bounds.bottom + step + contentHeight) / step);
+
+            for (int cy = 0; cy < endY; ++cy) {
+                if (isAborted && isAborted()) return;
+                for (int cx = 0; cx < endX; ++cx) {
+                    auto contentBounds = content.bounds();
+                    contentBounds.left += cx * step;
+                    contentBounds.right += cx * step;
+                    contentBounds.top += cy * step;
+                    contentBounds.bottom += cy * step;
+
+                    auto newBounds(_bounds + contentBounds);
+                    float area = newBounds.area();
+                    if (scan.isPlaces && (area >= scan.bestArea)) {
+                        // the area doesn't shrink to the right once the content sticks out,
+                        // and the rows below can't beat the first cell of this one once it sticks out
+                        if ((cx == 0) && (contentBounds.bottom > _bounds.bottom)) return;
+                        if (contentBounds.right > _bounds.right) break;
+                        continue;
+                    }
+                    if (newBounds.width() > sizeLimit) break;
+                    if (newBounds.height() > sizeLimit) return;
+                    if ((cx + mask.width > _grid.width) || (cy + mask.height > _grid.height)) break;
+
+                    if (_grid.overlaps(mask, cx, cy)) continue;
+                    if (intersects(content, cx * step, cy * step)) continue;
+
+                    scan.bestArea = area;
+                    scan.bestX = cx;
+                    scan.bestY = cy;
+                    scan.isPlaces = true;
+                }
+            }
+        }
+
+        // exact triangle test against the placed contents
+        bool intersects(const Content<T>& content, float x, float y) const {
+            auto contentBounds = content.bounds();
+            contentBounds.left += x;
+            contentBounds.right += x;
+            contentBounds.top += y;
+            contentBounds.bottom += y;
+
+            Point offset = content.treeOffset() + Point(x, y);
+            for (auto in_it = _contentList.begin(); in_it != _contentList.end(); ++in_it) {
+                if (!rectIntersect(contentBounds, (*in_it).bounds())) continue;
+
+                if (content.tree().intersects(offset, (*in_it).tree(), (*in_it).treeOffset())) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
         Rect _bounds;
         ContentList<T> _contentList;
+        Mask _grid;
     };
 
 }
@@ -0,0 +1,176 @@
+/**
+ * Skyline2D is a single bin rectangle packer that keeps only the top outline (skyline)
+ * of the placed rectangles, as a list of horizontal segments.
+ * A rectangle goes to the segment where its top edge ends lowest (bottom-left rule),
+ * the area below the skyline is never reused. Placement is O(segments), which stays
+ * small, so it is the fastest choice for thousands of small sprites.
+ *
+ * Uses BinPack2D::Content for input and output, and has the same Place/PlaceAll/GetContents
+ * interface as BinPack2D::Canvas.
+ */
+
+#pragma once
+
+#include <vector>
+#include <limits>
+#include "binpack2d.hpp"
+
+namespace Skyline2D {
+
+    struct Segment {
+        int x;
+        int y;
+        int w;
+
+        Segment(int x, int y, int w)
+        : x(x), y(y), w(w)
+        {}
+    };
+
+    template<typename _T> class Canvas {
+
+        std::vector<Segment> skyline;
+        typename BinPack2D::Content<_T>::Vector contentVector;
+
+    public:
+
+        const int w;
+        const int h;
+
+        Canvas(int w, int h)
+        : w(w),
+        h(h)
+        {
+            skyline.push_back( Segment(0, 0, w) );
+        }
+
+        const typename BinPack2D::Content<_T>::Vector &GetContents( ) const {
+
+            return contentVector;
+        }
+
+        bool Place(const typename BinPack2D::Content<_T>::Vector &contentVector, typename BinPack2D::Content<_T>::Vector &remainder) {
+
+            bool placedAll = true;
+
+            for( typename BinPack2D::Content<_T>::Vector::const_iterator itor = contentVector.begin(); itor != contentVector.end(); itor++ ) {
+
+                if( Place( *itor ) == false ) {
+
+                    placedAll = false;
+                    remainder.push_back( *itor );
+                }
+            }
+
+            return placedAll;
+        }
+
+        // stops at the first content that doesn't fit, for size search where the remainder is not needed
+        bool PlaceAll(const typename BinPack2D::Content<_T>::Vector &contentVector) {
+
+            for( typename BinPack2D::Content<_T>::Vector::const_iterator itor = contentVector.begin(); itor != contentVector.end(); itor++ )
+                if( Place( *itor ) == false )
+                    return false;
+
+            return true;
+        }
+
+        bool Place(BinPack2D::Content<_T> content) {
+
+            int bestIndex = -1;
+            int bestTop = std::numeric_limits<int>::max();
+            int bestWidth = std::numeric_limits<int>::max();
+            int bestY = 0;
+            bool rotate = false;
+
+            FindPosition(content.size.w, content.size.h, false, bestIndex, bestTop, bestWidth, bestY, rotate);
+            if (content.tryRotate && (content.size.w != content.size.h))
+                FindPosition(content.size.h, content.size.w, true, bestIndex, bestTop, bestWidth, bestY, rotate);
+
+            if (bestIndex < 0)
+                return false;
+
+            if (rotate)
+                content.Rotate();
+
+            content.coord = BinPack2D::Coord(skyline[bestIndex].x, bestY);
+            AddLevel(bestIndex, content.coord.x, bestY + content.size.h, content.size.w);
+            contentVector.push_back( content );
+
+            return true;
+        }
+
+    private:
+
+        // y where a width wide rectangle rests when its left edge is on the segment, or -1
+        int Fit(size_t index, int width, int height) const {
+
+            int x = skyline[index].x;
+            if (x + width > w)
+                return -1;
+
+            int y = 0;
+            int widthLeft = width;
+            for (size_t i = index; widthLeft > 0; ++i) {
+                y = std::max(y, skyline[i].y);
+                if (y + height > h)
+                    return -1;
+                widthLeft -= skyline[i].w;
+            }
+
+            return y;
+        }
+
+        void FindPosition(int width, int height, bool rotated, int &bestIndex, int &bestTop, int &bestWidth, int &bestY, bool &rotate) const {
+
+            for (size_t i = 0; i < skyline.size(); ++i) {
+
+                int y = Fit(i, width, height);
+                if (y < 0)
+                    continue;
+
+                if ((y + height < bestTop) || ((y + height == bestTop) && (skyline[i].w < bestWidth))) {
+                    bestIndex = (int)i;
+                    bestTop = y + height;
+                    bestWidth = skyline[i].w;
+                    bestY = y;
+                    rotate = rotated;
+                }
+            }
+        }
+
+        void AddLevel(int index, int x, int y, int width) {
+
+            skyline.insert(skyline.begin() + index, Segment(x, y, width));
+
+            // cut the segments under the new one
+            for (size_t i = index + 1; i < skyline.size(); ) {
+
+                Segment &segment = skyline[i];
+                int shrink = x + width - segment.x;
+                if (shrink <= 0)
+                    break;
+
+                segment.x += shrink;
+                segment.w -= shrink;
+                if (segment.w <= 0) {
+                    skyline.erase(skyline.begin() + i);
+                } else {
+                    break;
+                }
+            }
+
+            // merge neighbours at the same height
+            for (size_t i = 0; i + 1 < skyline.size(); ) {
+
+                if (skyline[i].y == skyline[i + 1].y) {
+                    skyline[i].w += skyline[i + 1].w;
+                    skyline.erase(skyline.begin() + i + 1);
+                } else {
+                    ++i;
+                }
+            }
+        }
+    };
+
+} /*** Skyline2D ***/
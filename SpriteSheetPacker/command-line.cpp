@@ -2,6 +2,7 @@
 #include "SpriteAtlas.h"
 #include "PublishSpriteSheet.h"
 #include "SpritePackerProjectFile.h"
+#include "PngEncoder.h"
 
 int commandLine(QCoreApplication& app) {
     QCommandLineParser parser;
@@ -16,7 +17,7 @@ int commandLine(QCoreApplication& app) {
         {"trimMode", "Rect - Removes the transparency around a sprite. The sprites appear to have their original size when using them.\n\
 Polygon - The amount of rendered transparency can be reduced by creating a tight fitting polygon around the solid pixels of a sprite. But: The vertices must be transformed by the CPU — introducing new costs.\n\
 Default is Rect", "mode", "Rect"},
-        {"algorithm", "Rect or Polygon. Default is Rect", "mode", "Rect"},
+        {"algorithm", "Rect, MaxRects-BSSF, MaxRects-BAF, MaxRects-BL, MaxRects-CP, Skyline, Polygon or Polygon-Grid. Default is Rect", "mode", "Rect"},
         {"trim", "Allowed values: 1 to 255, default is 1. Pixels with an alpha value below this value will be considered transparent when trimming the sprite. Very useful for sprites with nearly invisible alpha pixels at the borders.", "int", "1"},
         {"epsilon", "Lower values create a tighter fitting mesh with less transparency but with more vertices.\nHigher values on the other hand reduce the number of vertices at the cost of adding more transparency.", "float", "5"},
         {"texture-border", "Border of the sprite sheet, value adds transparent pixels around the borders of the sprite sheet. Default value is 0.", "int", "0"},
@@ -25,9 +26,14 @@ Default is Rect", "mode", "Rect"},
         {"max-size", "Sets the maximum size for the texture, default is 8192.", "size", "8192"},
         {"png-opt-mode", "Optimizes the png's file size.\n\
 None - No optimization at all(fastest).\n\
-Lossless - Uses optipng to optimize the filesize. The reduction is mostly small but doesn't harm image quality.\n\
+Lossless - Runs the optipng compression trials to optimize the filesize. The reduction is mostly small but doesn't harm image quality.\n\
 Lossy - Uses pngquant to optimize the filesize. The reduction is mostly about 70%, but the image quality gets a bit worse.", "int", "0"},
-        {"png-opt-level", "Optimizes the image's file size. Only useful in combination with opt-mode Lossless. Allowed values: 1 to 7 (Using a high value might take some time to optimize.", "int", "0"},
+        {"png-opt-level", "Optimizes the image's file size. Only useful in combination with opt-mode Lossless or Lossy (higher is slower quantization). Allowed values: 1 to 7 (Using a high value might take some time to optimize.", "int", "0"},
+        {"png-quality", "Quality range of the Lossy png-opt-mode like in pngquant, e.g. 65-80. Quantization fails when the maximum can't be reached with at least the minimum quality. Default is 0-100.", "min-max", "0-100"},
+        {"png-preset", "PNG encoding when png-opt-mode is None.\n\
+Fast - Fastest encoding, bigger files. Good for iteration builds.\n\
+Balanced - Default, fast with good compression.\n\
+Max - Best zlib compression, slowest.", "preset", "Balanced"},
         {"scale", "Scales all images before creating the sheet. E.g. use 0.5 for half size, default is 1 (Scale has no effect when source is a project file).", "float", "1"},
         {"trimSpriteNames", "Remove image file extensions from the sprite names - e.g. .png, .jpg, ...", "bool", "false"},
         {"prependSmartFolderName", "Prepends the smart folder's name as part of the sprite name.", "bool", "false"},
@@ -92,6 +98,9 @@ Lossy - Uses pngquant to optimize the filesize. The reduction is mostly about 70
     QString format = "cocos2d";
     QString pngOptMode = "None";
     int pngOptLevel = 0;
+    int pngQualityMin = 0;
+    int pngQualityMax = 100;
+    QString pngEncodePreset = "Balanced";
     bool trimSpriteNames = false;
     bool prependSmartFolderName = false;
 
@@ -107,6 +116,9 @@ Lossy - Uses pngquant to optimize the filesize. The reduction is mostly about 70
             spriteBorder = projectFile->spriteBorder();
             pngOptMode = projectFile->pngOptMode();
             pngOptLevel = projectFile->pngOptLevel();
+            pngQualityMin = projectFile->pngQualityMin();
+            pngQualityMax = projectFile->pngQualityMax();
+            pngEncodePreset = projectFile->pngEncodePreset();
             trimSpriteNames = projectFile->trimSpriteNames();
             prependSmartFolderName = projectFile->prependSmartFolderName();
 
@@ -166,6 +178,20 @@ Lossy - Uses pngquant to optimize the filesize. The reduction is mostly about 70
         pngOptLevel = qBound(1, pngOptLevel, 7);
     }
 
+    if (parser.isSet("png-quality")) {
+        QStringList range = parser.value("png-quality").split("-");
+        pngQualityMin = qBound(0, range.first().toInt(), 100);
+        pngQualityMax = qBound(pngQualityMin, range.last().toInt(), 100);
+    }
+
+    if (parser.isSet("png-preset")) {
+        pngEncodePreset = parser.value("png-preset");
+        if (!PngEncodeSettings::presets().contains(pngEncodePreset)) {
+            qWarning() << "Unknown png-preset" << pngEncodePreset << "use Balanced";
+            pngEncodePreset = "Balanced";
+        }
+    }
+
     qDebug() << "trimMode:" << trimMode;
     qDebug() << "algorithm:" << algorithm;
     qDebug() << "trim:" << trim;
@@ -177,6 +203,8 @@ Lossy - Uses pngquant to optimize the filesize. The reduction is mostly about 70
     qDebug() << "scale:" << imageScale;
     qDebug() << "png-opt-mode:" << pngOptMode;
     qDebug() << "png-opt-level:" << pngOptLevel;
+    qDebug() << "png-quality:" << pngQualityMin << "-" << pngQualityMax;
+    qDebug() << "png-preset:" << pngEncodePreset;
 
     // load formats
     QSettings settings;
@@ -231,9 +259,7 @@ Lossy - Uses pngquant to optimize the filesize. The reduction is mostly about 70
             if (trimMode == "Polygon") {
                 atlas.enablePolygonMode(true, epsilon);
             }
-            if (algorithm == "Polygon") {
-             atlas.setAlgorithm(algorithm);
-            }
+            atlas.setAlgorithm(algorithm);
             if (!atlas.generate()) {
                 qCritical() << "ERROR: Generate atlas!";
                 return -1;
@@ -254,9 +280,7 @@ Lossy - Uses pngquant to optimize the filesize. The reduction is mostly about 70
         if (trimMode == "Polygon") {
             atlas.enablePolygonMode(true, epsilon);
         }
-        if (algorithm == "Polygon") {
-         atlas.setAlgorithm(algorithm);
-        }
+        atlas.setAlgorithm(algorithm);
         if (!atlas.generate()) {
             qCritical() << "ERROR: Generate atlas!";
             return -1;
@@ -268,8 +292,10 @@ Lossy - Uses pngquant to optimize the filesize. The reduction is mostly about 70
     publisher.setTrimSpriteNames(trimSpriteNames);
     publisher.setPrependSmartFolderName(prependSmartFolderName);
     publisher.setPngQuality(pngOptMode, pngOptLevel);
+    publisher.setPngQuantQuality(pngQualityMin, pngQualityMax);
+    publisher.setPngEncodePreset(pngEncodePreset);
 
-    if (!publisher.publish(format, false)) {
+    if (!publisher.publish(format, false) || !publisher.waitForFinished()) {
         qCritical() << "ERROR: publish atlas!";
         return -1;
     }
@@ -1,11 +1,16 @@
 
 
-function exportSpriteSheet(dataFilePath, imageFilePath, spriteFrames) {
+function exportSpriteSheet(dataFilePath, imageFilePath, spriteFrames, textureSize, page) {
     var plist = {};
     plist["metadata"] = {
         "format": 2,
         "textureFileName": imageFilePath.replace(/^.*[\\\/]/, '')
     };
+    if (page) {
+        plist["metadata"]["page"] = page.index;
+        plist["metadata"]["pageCount"] = page.count;
+        plist["metadata"]["fillRatio"] = page.fillRatio;
+    }
 
     console.log("Collect spriteframes for cocos2d plist data");
     var cocosFrames = {};
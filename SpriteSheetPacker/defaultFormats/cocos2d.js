@@ -1,6 +1,6 @@
 
 
-function exportSpriteSheet(dataFilePath, imageFilePath, spriteFrames, textureSize) {
+function exportSpriteSheet(dataFilePath, imageFilePath, spriteFrames, textureSize, page) {
     var plist = {};
     plist["metadata"] = {
         "format": 3,
@@ -9,6 +9,11 @@ function exportSpriteSheet(dataFilePath, imageFilePath, spriteFrames, textureSiz
     if (textureSize) {
         plist["metadata"]["size"] = "{" + textureSize.width + "," + textureSize.height + "}";
     }
+    if (page) {
+        plist["metadata"]["page"] = page.index;
+        plist["metadata"]["pageCount"] = page.count;
+        plist["metadata"]["fillRatio"] = page.fillRatio;
+    }
 
     console.log("Collect spriteframes for cocos2d plist data");
     var cocosFrames = {};
@@ -46,7 +51,12 @@ function exportSpriteSheet(dataFilePath, imageFilePath, spriteFrames, textureSiz
             for (var v in spriteFrame.triangles.verts) {
                 var vtx = spriteFrame.triangles.verts[v];
                 vertices += (vtx.x + spriteFrame.offset.x) + " " + (vtx.y + spriteFrame.offset.y) + " ";
-                verticesUV += (spriteFrame.frame.x + vtx.x) + " " + (spriteFrame.frame.y + vtx.y) + " ";
+                if (spriteFrame.rotated) {
+                    // turned 90 degrees clockwise in the texture
+                    verticesUV += (spriteFrame.frame.x + spriteFrame.sourceColorRect.height - vtx.y) + " " + (spriteFrame.frame.y + vtx.x) + " ";
+                } else {
+                    verticesUV += (spriteFrame.frame.x + vtx.x) + " " + (spriteFrame.frame.y + vtx.y) + " ";
+                }
             }
             for (var i in spriteFrame.triangles.indices) {
                 triangles += spriteFrame.triangles.indices[i] + " ";
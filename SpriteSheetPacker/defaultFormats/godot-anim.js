@@ -1,6 +1,6 @@
 
 
-function exportSpriteSheet(dataFilePath, imageFilePath, spriteFrames)
+function exportSpriteSheet(dataFilePath, imageFilePath, spriteFrames, textureSize, page)
 {
     var loopCount = 0;
     var contents = "";
@@ -93,6 +93,14 @@ function exportSpriteSheet(dataFilePath, imageFilePath, spriteFrames)
     contents += "[node name=\"AnimatedSprite\" type=\"AnimatedSprite\"]\n";
     contents += "frames = SubResource( " + (imageCount + 1) + " )\n";
     contents += "frame = 0\n";
+    // page of the sheet as node metadata
+    if (page) {
+        contents += "__meta__ = {\n";
+        contents += "\"fillRatio\": " + page.fillRatio + ",\n";
+        contents += "\"page\": " + page.index + ",\n";
+        contents += "\"pageCount\": " + page.count + "\n";
+        contents += "}\n";
+    }
     contents += "\n";
     
     return {
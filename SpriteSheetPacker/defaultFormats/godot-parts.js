@@ -1,6 +1,6 @@
 
 
-function exportSpriteSheet(dataFilePath, imageFilePath, spriteFrames)
+function exportSpriteSheet(dataFilePath, imageFilePath, spriteFrames, textureSize, page)
 {
     var loopCount = 0;
     var contents = "";
@@ -30,7 +30,16 @@ function exportSpriteSheet(dataFilePath, imageFilePath, spriteFrames)
     contents += "[ext_resource path=\"res://" + getFileName(imageFilePath) + "\" type=\"Texture\" id=1]\n";
     contents += "\n";
     contents += imageList;
-    contents += "[node name=\"" + getFileNameWithoutExtension(imageFilePath) + "\" type=\"Sprite\"]\n\n";
+    contents += "[node name=\"" + getFileNameWithoutExtension(imageFilePath) + "\" type=\"Sprite\"]\n";
+    // page of the sheet as node metadata
+    if (page) {
+        contents += "__meta__ = {\n";
+        contents += "\"fillRatio\": " + page.fillRatio + ",\n";
+        contents += "\"page\": " + page.index + ",\n";
+        contents += "\"pageCount\": " + page.count + "\n";
+        contents += "}\n";
+    }
+    contents += "\n";
     
     var partNumber = 1;
     
@@ -1,6 +1,6 @@
 
 
-function exportSpriteSheet(dataFilePath, imageFilePath, spriteFrames) {
+function exportSpriteSheet(dataFilePath, imageFilePath, spriteFrames, textureSize, page) {
     var jsonFrames = {};
     for (var key in spriteFrames) {
         var spriteFrame = spriteFrames[key];
@@ -13,6 +13,23 @@ function exportSpriteSheet(dataFilePath, imageFilePath, spriteFrames) {
         jsonFrames[key] = cocosFrame;
     }
 
+    // the frames are top level, so the page info only goes in when no sprite is called meta
+    if (page) {
+        if (jsonFrames["meta"] === undefined) {
+            jsonFrames["meta"] = {
+                "image": imageFilePath.replace(/^.*[\\\/]/, ''),
+                "page": page.index,
+                "pageCount": page.count,
+                "fillRatio": page.fillRatio
+            };
+            if (textureSize) {
+                jsonFrames["meta"]["size"] = { "w": textureSize.width, "h": textureSize.height };
+            }
+        } else {
+            console.log("Sprite named meta, no page info written");
+        }
+    }
+
     return {
         data: JSON.stringify(jsonFrames, null, "\t"),
         format: "json"
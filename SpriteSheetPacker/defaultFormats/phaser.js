@@ -1,4 +1,4 @@
-function exportSpriteSheet(dataFilePath, imageFilePaths, spriteFrames) {
+function exportSpriteSheet(dataFilePath, imageFilePaths, spriteFrames, textureSize, page) {
     var imageFilePath = imageFilePaths.rgb || imageFilePaths;
     var maskFilePath = imageFilePaths.mask;
     var jsonFrames = [];
@@ -41,6 +41,12 @@ function exportSpriteSheet(dataFilePath, imageFilePaths, spriteFrames) {
         meta.mask = maskFilePath.replace(/^.*[\\\/]/, '');
     }
 
+    if (page) {
+        meta.page = page.index;
+        meta.pageCount = page.count;
+        meta.fillRatio = page.fillRatio;
+    }
+
     return {
         data: JSON.stringify({
                                  frames: jsonFrames,
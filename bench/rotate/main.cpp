@@ -0,0 +1,95 @@
+#include <QtCore>
+#include <QImage>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include "ImageRotate.h"
+
+namespace {
+
+    // the rotation before the 32-bit kernels, one setPixel per pixel
+    QImage oldRotate90(const QImage &src) {
+        QImage dst(src.height(), src.width(), src.format());
+        for (int y=0;y<src.height();++y) {
+            const uint *srcLine = reinterpret_cast< const uint * >(src.scanLine(y));
+            for (int x=0;x<src.width();++x) {
+                dst.setPixel(src.height()-y-1, x, srcLine[x]);
+            }
+        }
+        return dst;
+    }
+    QImage oldRotate180(const QImage &src) {
+        QImage dst(src.width(), src.height(), src.format());
+        for (int y=0;y<src.height();++y) {
+            const uint *srcLine = reinterpret_cast< const uint * >(src.scanLine(y));
+            for (int x=0;x<src.width();++x) {
+                dst.setPixel(src.width()-x-1, src.height()-y-1, srcLine[x]);
+            }
+        }
+        return dst;
+    }
+    QImage oldRotate270(const QImage &src) {
+        QImage dst(src.height(), src.width(), src.format());
+        for (int y=0;y<src.height();++y) {
+            const uint *srcLine = reinterpret_cast< const uint * >(src.scanLine(y));
+            for (int x=0;x<src.width();++x) {
+                dst.setPixel(y, src.width()-x-1, srcLine[x]);
+            }
+        }
+        return dst;
+    }
+
+    // best of runs, in milliseconds
+    double measure(const std::function<QImage()>& rotate, int runs, QImage& result) {
+        double best = std::numeric_limits<double>::max();
+        for (int i=0; i<runs; ++i) {
+            QElapsedTimer timer;
+            timer.start();
+            result = rotate();
+            best = qMin(best, timer.nsecsElapsed() / 1000000.0);
+        }
+        return best;
+    }
+
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+
+    const int size = (argc > 1)? QString(argv[1]).toInt() : 2048;
+    const int runs = 10;
+
+    QImage image(size, size, QImage::Format_ARGB32);
+    quint32 seed = 1;
+    for (int y=0; y<image.height(); ++y) {
+        quint32 *line = reinterpret_cast<quint32*>(image.scanLine(y));
+        for (int x=0; x<image.width(); ++x) {
+            seed = seed * 1664525u + 1013904223u;
+            line[x] = seed;
+        }
+    }
+
+    struct Case {
+        const char *name;
+        std::function<QImage(const QImage&)> rotate;
+        std::function<QImage(const QImage&)> oldRotate;
+    };
+    const Case cases[] = {
+        {"rotate90", [](const QImage& src) { return rotate90(src); }, oldRotate90},
+        {"rotate180", [](const QImage& src) { return rotate180(src); }, oldRotate180},
+        {"rotate270", [](const QImage& src) { return rotate270(src); }, oldRotate270},
+    };
+
+    printf("%dx%d ARGB32, best of %d runs\n", size, size, runs);
+    bool same = true;
+    for (const Case& c: cases) {
+        QImage result, oldResult;
+        double time = measure([&]() { return c.rotate(image); }, runs, result);
+        double oldTime = measure([&]() { return c.oldRotate(image); }, runs, oldResult);
+        bool equal = (result == oldResult);
+        same = same && equal;
+        printf("%-10s kernel %8.2f ms   setPixel %8.2f ms   x%.1f%s\n", c.name, time, oldTime, oldTime / qMax(time, 0.001), equal? "" : "   MISMATCH");
+    }
+
+    return same? 0 : 1;
+}
@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Benchmark of the ImageRotate kernels against the old setPixel rotation,
+# standalone, not part of sprite-sheet-packer.pro:
+#   qmake rotate.pro && make && ./rotate
+#
+#-------------------------------------------------
+
+QT += core gui
+QT -= widgets
+
+TARGET = rotate
+TEMPLATE = app
+
+CONFIG += c++11 console release
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../../SpriteSheetPacker
+
+SOURCES += main.cpp \
+    ../../SpriteSheetPacker/ImageRotate.cpp
+
+HEADERS += ../../SpriteSheetPacker/ImageRotate.h